@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+
+// Runs work the given number of times and returns the fastest run in
+// milliseconds, so a cold cache or a busy moment doesn't skew the result
+template <typename Work>
+double fastestRunMs(int runs, Work work) {
+    double fastest = 0;
+    for(int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if(i == 0 || elapsed.count() < fastest) {
+            fastest = elapsed.count();
+        }
+    }
+
+    return fastest;
+}
@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+/*
+ * Writes a synthetic list of about the given number of lines (3 million by
+ * default) to stdout, for the benchmarks to parse. Sections range from a
+ * handful of items to a few thousand, and some items carry due dates, tags
+ * and priorities like real ones do. The same count always gives the same
+ * list.
+ */
+int main(int argc, char ** argv) {
+    long numLines = argc > 1 ? atol(argv[1]) : 3000000;
+    if(numLines <= 0) {
+        fprintf(stderr, "usage: %s [lines]\n", argv[0]);
+        return 1;
+    }
+
+    static const char * words[] = {
+        "Clean", "house", "take", "out", "garbage", "schedule", "car", "maintenance", "finish",
+        "registration", "controls", "team", "meeting", "homework", "final", "project", "review",
+        "notes", "call", "back", "order", "parts", "write", "report", "update", "docs",
+    };
+    const int numWords = sizeof(words) / sizeof(words[0]);
+
+    std::mt19937 rng(1);
+    std::string out;
+    long line = 0;
+    int section = 0;
+    while(line < numLines) {
+        out += "[Section " + std::to_string(section++) + "] : " + std::to_string(rng() % 8) + "\n";
+        line++;
+
+        long numItems = std::min<long>(1 + rng() % 3000, numLines - line);
+        for(long i = 0; i < numItems; i++) {
+            int length = 3 + rng() % 6;
+            for(int w = 0; w < length; w++) {
+                out += words[rng() % numWords];
+                out += ' ';
+            }
+            out += std::to_string(i);
+            switch(rng() % 8) {
+                case 0: out += " @" + std::to_string(1 + rng() % 12) + "/" + std::to_string(1 + rng() % 28); break;
+                case 1: out += " #" + std::string(words[rng() % numWords]); break;
+                case 2: out += " !" + std::to_string(1 + rng() % 9); break;
+            }
+            out += '\n';
+        }
+        line += numItems;
+
+        out += '\n';
+        line++;
+        if(out.size() > (1 << 20)) {
+            fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+    }
+
+    fwrite(out.data(), 1, out.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "FileProcessor.hpp"
+#include "LineScanner.hpp"
+
+#define RUNS 5
+
+/*
+ * Compares the LineScanner kernels (AVX2, SSE2 and the scalar fallback) on
+ * a list, both on their own and through the FileProcessor that the parser
+ * reads lines with. Reading the lines with std::getline, as the parser did
+ * before the scanner, is timed alongside for reference.
+ */
+
+static size_t countNewlines(std::string_view contents) {
+    std::vector<size_t> newlines;
+    size_t count = 0;
+    for(size_t begin = 0; begin < contents.size(); begin += NEWLINE_WINDOW_SIZE) {
+        newlines.clear();
+        LineScanner::findNewlines(contents, begin, begin + NEWLINE_WINDOW_SIZE, newlines);
+        count += newlines.size();
+    }
+
+    return count;
+}
+
+static size_t countBlankLines(std::string_view contents) {
+    size_t count = 0;
+    size_t found = LineScanner::findBlankLine(contents, 0);
+    while(found != std::string_view::npos) {
+        count++;
+        found = LineScanner::findBlankLine(contents, found + 1);
+    }
+
+    return count;
+}
+
+static size_t countSectionHeaders(std::string_view contents) {
+    size_t count = 0;
+    size_t found = LineScanner::findSectionHeader(contents, 0);
+    while(found != std::string_view::npos) {
+        count++;
+        found = LineScanner::findSectionHeader(contents, found + 1);
+    }
+
+    return count;
+}
+
+static size_t countFileProcessorLines(std::shared_ptr<MappedFile> file) {
+    FileProcessor fproc(file, file->getContents());
+    size_t count = 0;
+    while(!fproc.isEOF) {
+        fproc.poll();
+        count++;
+    }
+
+    return count;
+}
+
+static size_t countGetlineLines(std::string path) {
+    std::ifstream input(path);
+    std::string line;
+    size_t count = 0;
+    while(std::getline(input, line)) {
+        count++;
+    }
+
+    return count;
+}
+
+int main(int argc, char ** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <list>\n", argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+    std::string_view contents = file->getContents();
+    double megabytes = contents.size() / (1024.0 * 1024.0);
+
+    // Fault the whole list in first, so the first kernel isn't charged for it
+    size_t numLines = countFileProcessorLines(file);
+    printf("%s: %.1f MiB, %zu lines, best of %d runs\n\n", path.c_str(), megabytes, numLines, RUNS);
+    printf("%-8s %14s %14s %14s %14s\n", "kernel", "newlines", "blank lines", "headers", "FileProcessor");
+
+    size_t checks[4] = {0, 0, 0, 0};
+    LineScanner::Kernel kernels[] = {LineScanner::AVX2_KERNEL, LineScanner::SSE2_KERNEL, LineScanner::SCALAR_KERNEL};
+    for(LineScanner::Kernel kernel : kernels) {
+        if(!LineScanner::useKernel(kernel)) {
+            printf("%-8s %14s\n", LineScanner::getKernelName(kernel), "not supported");
+            continue;
+        }
+
+        size_t counts[4];
+        double times[4];
+        times[0] = fastestRunMs(RUNS, [&]() { counts[0] = countNewlines(contents); });
+        times[1] = fastestRunMs(RUNS, [&]() { counts[1] = countBlankLines(contents); });
+        times[2] = fastestRunMs(RUNS, [&]() { counts[2] = countSectionHeaders(contents); });
+        times[3] = fastestRunMs(RUNS, [&]() { counts[3] = countFileProcessorLines(file); });
+
+        printf("%-8s", LineScanner::getKernelName(kernel));
+        for(int i = 0; i < 4; i++) {
+            printf(" %8.0f MiB/s", megabytes / (times[i] / 1000.0));
+            if(checks[i] != 0 && checks[i] != counts[i]) {
+                fprintf(stderr, "%s found %zu where the others found %zu\n", LineScanner::getKernelName(kernel),
+                        counts[i], checks[i]);
+                return 1;
+            }
+            checks[i] = counts[i];
+        }
+        printf("\n");
+    }
+
+    size_t getlineLines = 0;
+    double getlineTime = fastestRunMs(RUNS, [&]() { getlineLines = countGetlineLines(path); });
+    printf("%-8s %14s %14s %14s %8.0f MiB/s  (std::getline, before the scanner)\n", "getline", "", "", "",
+           megabytes / (getlineTime / 1000.0));
+    if(getlineLines != checks[3]) {
+        fprintf(stderr, "getline read %zu lines where FileProcessor read %zu\n", getlineLines, checks[3]);
+        return 1;
+    }
+
+    return 0;
+}
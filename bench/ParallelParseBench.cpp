@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+#include "ListParser.hpp"
+
+#define RUNS 3
+
+/*
+ * Parses a list on 1, 2, 4, ... threads up to the given count (twice the
+ * number of cores by default, and at least 8), and reports how parsing
+ * scales against the front to back parse. Counts past the number of cores
+ * only show what splitting the list costs.
+ */
+int main(int argc, char ** argv) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <list> [max threads]\n", argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    unsigned numCores = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned maxThreads = argc > 2 ? (unsigned)atoi(argv[2]) : std::max(numCores * 2, 8u);
+
+    std::vector<unsigned> threadCounts;
+    for(unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if(numCores > 1 && numCores < maxThreads) {
+        threadCounts.push_back(numCores);
+    }
+    threadCounts.push_back(maxThreads);
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+    // Fault the whole list in first, so the first run isn't charged for it
+    size_t numSections = ListParser(path).parseList(1).size();
+    printf("%s: %zu sections, %u cores, best of %d runs\n\n", path.c_str(), numSections, numCores, RUNS);
+    printf("%8s %10s %8s\n", "threads", "ms", "speedup");
+
+    double single = 0;
+    for(unsigned threads : threadCounts) {
+        size_t parsed = 0;
+        double time = fastestRunMs(RUNS, [&]() {
+            ListParser parser(path);
+            parsed = parser.parseList(threads).size();
+        });
+        if(parsed != numSections) {
+            fprintf(stderr, "%u threads parsed %zu sections where 1 parsed %zu\n", threads, parsed, numSections);
+            return 1;
+        }
+
+        if(threads == 1) {
+            single = time;
+        }
+        printf("%8u %10.1f %7.2fx%s\n", threads, time, single / time, threads > numCores ? "  (more than cores)" : "");
+    }
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+// Elements per chunk of a ChunkedSequence. Full chunks are split in half,
+// and a chunk is merged into its neighbour once they fit in half of one.
+#define SEQUENCE_CHUNK_CAPACITY 512
+
+/*
+ * A ChunkedSequence is a vector cut into chunks of up to
+ * SEQUENCE_CHUNK_CAPACITY elements, with a Fenwick tree over the chunk
+ * sizes to find the chunk holding an index. Indexing, inserting and erasing
+ * anywhere cost O(log n) plus the moves within one chunk, instead of
+ * shifting everything behind the change. Splits and merges move only the
+ * chunk pointers. A sequence smaller than one chunk behaves like a plain
+ * vector.
+ *
+ * Chunks are shared between copies of a sequence and copied the first time
+ * one of the copies changes them, so copying a sequence copies only its
+ * chunk pointers.
+ */
+template <typename T>
+class ChunkedSequence {
+
+private:
+    typedef std::vector<T> Chunk;
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    std::vector<size_t> tree;   // Fenwick tree of chunk sizes, 1-based
+    size_t count;
+
+    void rebuildTree() {
+        size_t numChunks = chunks.size();
+        tree.assign(numChunks + 1, 0);
+        for(size_t i = 1; i <= numChunks; i++) {
+            tree[i] += chunks[i - 1]->size();
+            size_t parent = i + (i & (~i + 1));
+            if(parent <= numChunks) {
+                tree[parent] += tree[i];
+            }
+        }
+    }
+
+    // Counts one element more or less in a chunk
+    void adjustChunkSize(size_t chunk, bool grow) {
+        for(size_t i = chunk + 1; i < tree.size(); i += i & (~i + 1)) {
+            tree[i] = grow ? tree[i] + 1 : tree[i] - 1;
+        }
+    }
+
+    // Finds the chunk holding index, and where in that chunk it is
+    size_t locate(size_t index, size_t & offset) const {
+        size_t position = 0;
+        size_t step = 1;
+        while(step * 2 < tree.size()) {
+            step *= 2;
+        }
+
+        for(; step > 0; step /= 2) {
+            if(position + step < tree.size() && tree[position + step] <= index) {
+                position += step;
+                index -= tree[position];
+            }
+        }
+
+        offset = index;
+        return position;
+    }
+
+    // The chunk, copied first if another sequence shares it
+    Chunk & writable(size_t chunk) {
+        if(chunks[chunk].use_count() > 1) {
+            chunks[chunk] = std::make_shared<Chunk>(*chunks[chunk]);
+        }
+
+        return *chunks[chunk];
+    }
+
+    void splitChunk(size_t chunk) {
+        Chunk & full = writable(chunk);
+        size_t half = full.size() / 2;
+        std::shared_ptr<Chunk> back = std::make_shared<Chunk>(full.begin() + half, full.end());
+        full.erase(full.begin() + half, full.end());
+
+        chunks.insert(chunks.begin() + chunk + 1, back);
+        rebuildTree();
+    }
+
+    void mergeIfSmall(size_t chunk) {
+        if(chunks[chunk]->empty()) {
+            chunks.erase(chunks.begin() + chunk);
+            rebuildTree();
+            return;
+        }
+
+        // Fold the next chunk into this one once both fit in half a chunk, so
+        // erasing can't leave a trail of tiny chunks
+        size_t next = chunk + 1;
+        if(next >= chunks.size() || chunks[chunk]->size() + chunks[next]->size() > SEQUENCE_CHUNK_CAPACITY / 2) {
+            return;
+        }
+
+        Chunk & merged = writable(chunk);
+        merged.insert(merged.end(), chunks[next]->begin(), chunks[next]->end());
+        chunks.erase(chunks.begin() + next);
+        rebuildTree();
+    }
+
+public:
+    ChunkedSequence() : tree(1, 0), count(0) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const T & operator[](size_t index) const {
+        size_t offset;
+        size_t chunk = locate(index, offset);
+        return (*chunks[chunk])[offset];
+    }
+
+    void set(size_t index, const T & value) {
+        size_t offset;
+        size_t chunk = locate(index, offset);
+        writable(chunk)[offset] = value;
+    }
+
+    void push_back(const T & value) {
+        if(chunks.empty() || chunks.back()->size() >= SEQUENCE_CHUNK_CAPACITY) {
+            chunks.push_back(std::make_shared<Chunk>());
+            rebuildTree();
+        }
+
+        size_t last = chunks.size() - 1;
+        writable(last).push_back(value);
+        adjustChunkSize(last, true);
+        count++;
+    }
+
+    void insert(size_t index, const T & value) {
+        if(index >= count) {
+            push_back(value);
+            return;
+        }
+
+        size_t offset;
+        size_t chunk = locate(index, offset);
+        if(chunks[chunk]->size() >= SEQUENCE_CHUNK_CAPACITY) {
+            splitChunk(chunk);
+            chunk = locate(index, offset);
+        }
+
+        Chunk & target = writable(chunk);
+        target.insert(target.begin() + offset, value);
+        adjustChunkSize(chunk, true);
+        count++;
+    }
+
+    void erase(size_t index) {
+        size_t offset;
+        size_t chunk = locate(index, offset);
+        Chunk & target = writable(chunk);
+        target.erase(target.begin() + offset);
+        adjustChunkSize(chunk, false);
+        count--;
+
+        mergeIfSmall(chunk);
+    }
+
+    void swap(size_t a, size_t b) {
+        T first = (*this)[a];
+        set(a, (*this)[b]);
+        set(b, first);
+    }
+
+    void clear() {
+        chunks.clear();
+        tree.assign(1, 0);
+        count = 0;
+    }
+
+    // Calls visit on each element from first on, in order, until it returns
+    // false. Walking a chunk at a time avoids a lookup per element.
+    template <typename Visitor>
+    void visitFrom(size_t first, Visitor visit) const {
+        if(first >= count) { return; }
+
+        size_t offset;
+        size_t chunk = locate(first, offset);
+        for(; chunk < chunks.size(); chunk++, offset = 0) {
+            const Chunk & elements = *chunks[chunk];
+            for(; offset < elements.size(); offset++) {
+                if(!visit(elements[offset])) { return; }
+            }
+        }
+    }
+
+    // Calls visit(element, index) on each element in a chunk this sequence
+    // doesn't share with other. Copies only differ in the chunks one of them
+    // changed, so this finds what changed between two copies without
+    // comparing the rest.
+    template <typename Visitor>
+    void visitUnsharedWith(const ChunkedSequence & other, Visitor visit) const {
+        std::unordered_set<const Chunk *> shared;
+        shared.reserve(other.chunks.size());
+        for(const std::shared_ptr<Chunk> & chunk : other.chunks) {
+            shared.insert(chunk.get());
+        }
+
+        size_t index = 0;
+        for(const std::shared_ptr<Chunk> & chunk : chunks) {
+            if(shared.count(chunk.get()) > 0) {
+                index += chunk->size();
+                continue;
+            }
+
+            for(const T & element : *chunk) {
+                visit(element, index++);
+            }
+        }
+    }
+
+};
@@ -3,6 +3,8 @@
 #include "Config.hpp"
 #include "DialogForm.hpp"
 #include "ListSerializer.hpp"
+#include "FinderForm.hpp"
+#include "SearchForm.hpp"
 
 class Command {
 protected:
@@ -11,6 +13,12 @@ protected:
 	Command(State * state);
     void clearBehindDialogForm();
     bool checkForNumItems(int minimum);
+    void restoreSnapshot(EditHistory::Snapshot snapshot);
+    // Focus the next or previous search match after the highlighted item,
+    // or the highlighted item itself if it matches and includeCurrent is set
+    void focusSearchMatch(bool forward, bool includeCurrent);
+    // Moving items by hand ends keeping the focused section sorted
+    void stopKeepingSorted();
 public:
 	virtual ~Command() {}
 	virtual void execute() = 0;
@@ -41,6 +49,9 @@ public:
 };
 
 class SaveFileCommand : public Command {
+private:
+    void appendToJournal(ListJournal * journal);
+
 public:
     SaveFileCommand(State * state);
     void execute() override;
@@ -219,3 +230,89 @@ public:
     ChangeItemSectionDownCommand(State * state);
     void execute() override;
 };
+
+class UndoCommand : public Command {
+public:
+    UndoCommand(State * state);
+    void execute() override;
+};
+
+class RedoCommand : public Command {
+public:
+    RedoCommand(State * state);
+    void execute() override;
+};
+
+class SearchCommand : public Command {
+private:
+    SearchForm * form;
+
+    void setupEditBuffer();
+    std::string getUserInput();
+    void teardownEditBuffer();
+public:
+    SearchCommand(State * state);
+    void execute() override;
+};
+
+class FindItemCommand : public Command {
+private:
+    FinderForm * form;
+
+    void setupEditBuffer();
+    void getUserInput();
+    void teardownEditBuffer();
+public:
+    FindItemCommand(State * state);
+    void execute() override;
+};
+
+class FilterItemsCommand : public Command {
+private:
+    DialogForm * form;
+
+    void setupEditBuffer();
+    std::string getUserInput();
+    void teardownEditBuffer();
+public:
+    FilterItemsCommand(State * state);
+    void execute() override;
+};
+
+class SortCommand : public Command {
+private:
+    DialogForm * dialog;
+
+    void setupDialog();
+    char getUserChoice();
+    void teardownDialog();
+protected:
+    SortCommand(State * state);
+    // Asks how to sort, false if the dialog was cancelled
+    bool askForOrder(SortOrder & order, bool & keep);
+    void sortPanel(int panelIndex, SortOrder order, bool keep);
+};
+
+class SortSectionCommand : public SortCommand {
+public:
+    SortSectionCommand(State * state);
+    void execute() override;
+};
+
+class SortListCommand : public SortCommand {
+public:
+    SortListCommand(State * state);
+    void execute() override;
+};
+
+class NextMatchCommand : public Command {
+public:
+    NextMatchCommand(State * state);
+    void execute() override;
+};
+
+class PreviousMatchCommand : public Command {
+public:
+    PreviousMatchCommand(State * state);
+    void execute() override;
+};
@@ -2,6 +2,9 @@
 
 #include "Command.hpp"
 
+// The key code a terminal sends for Ctrl and a letter
+#define KEY_CTRL(c) ((c) & 0x1f)
+
 class CommandFactory {
 
 private:
@@ -6,16 +6,27 @@
 class DialogForm : public Form {
 
 private:
+    void drawDialog();
+
+protected:
     State * state;
 
     void resizeForm();
     void resizePanels();
-    void drawDialog();
+    // The next key typed, or ERR after timeoutMs, see EventLoop::waitForKey()
+    int readKey(int timeoutMs = -1);
+
+    // Called after every keystroke that reaches the buffer
+    virtual void inputChanged() {}
+    void redrawPanels();
 
 public:
     DialogForm(std::string prompt, State * state);
 
     std::string edit() override;
     bool dialog();
+    // Waits for one of the keys in choices and returns it, or 0 if the
+    // dialog was cancelled with F1
+    char choose(std::string choices);
 
 };
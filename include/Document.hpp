@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ItemIndex.hpp"
+#include "Section.hpp"
+
+// How far from where the ItemIndex last saw it an item is looked for before
+// its section's positions are all brought up to date
+#define ITEM_LOCATE_RADIUS 1024
+
+/*
+ * The Document owns the sections of the open list, in list order. Panels
+ * only hold a handle to the section they show, so adding, removing or
+ * moving a section never copies any of the others, and handles stay valid
+ * until their section is removed.
+ *
+ * Items can be found by ID through the Document's ItemIndex, which every
+ * section it holds keeps up to date.
+ */
+class Document {
+
+private:
+    ItemIndex itemIndex;
+    std::vector<std::unique_ptr<Section>> sections;
+
+    int indexOf(Section * handle);
+
+public:
+    Document();
+    Document(Document const &) = delete;
+    void operator=(Document const &) = delete;
+
+    Section * addSection(Section section);
+    void removeSection(Section * handle);
+    void swapSections(int a, int b);
+    // Put the sections in this order, dropping any that aren't listed
+    void arrange(std::vector<Section *> order);
+    int getNumSections();
+    Section * getSection(int index);
+    // Copies of every section, which share their items with the originals
+    std::vector<Section> copySections();
+    // Finds the section and position of the item with this ID. The index is
+    // built the first time this is called.
+    bool locateItem(uint64_t id, Section *& section, int & position);
+
+};
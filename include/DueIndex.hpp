@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Document.hpp"
+#include "SectionTracker.hpp"
+
+// How many days ahead the Upcoming panel looks when the config doesn't say
+#define DEFAULT_UPCOMING_DAYS 7
+// Height of the Upcoming panel, its title bar included
+#define UPCOMING_PANEL_LINES 6
+
+/*
+ * The DueIndex keeps every item in the Document that has a due date in
+ * order of that date, so the items due next are always at the front and
+ * the Upcoming panel never has to look at the rest.
+ *
+ * Like the SearchIndex it keeps up through a SectionTracker: the first
+ * build runs on the tracker's thread and lands the next time sync() is
+ * called, and after that sync() only reads the items that may have changed.
+ *
+ * Dates without a year are ordered by the year that puts them closest to
+ * today, so the order is worked out again when the day changes.
+ */
+class DueIndex {
+
+private:
+    struct Due {
+        int dueDate;            // As written, see ItemTokens
+        int resolved;           // With its year filled in
+        uint64_t sequence;      // Keeps items due the same day in list order
+        uint32_t stamp;
+        std::string_view text;  // Read from the tracker's copies
+        Section * section;
+    };
+
+    struct Tables {
+        std::unordered_map<uint64_t, Due> dues;
+        std::map<std::pair<int, uint64_t>, uint64_t> byDate;    // Item ID by resolved date
+        uint64_t nextSequence;
+        uint32_t stamp;
+        int today;
+
+        Tables() : nextSequence(0), stamp(0), today(0) {}
+    };
+
+    std::unique_ptr<Tables> tables;
+    std::unique_ptr<Tables> built;
+    SectionTracker tracker;
+
+    void startBuild(Document * document, int today);
+    void runBuild();
+    void finishBuild(Document * document, int today);
+    void stopBuild();
+
+    static void addItem(Tables & into, uint64_t id, std::string_view text, int dueDate, Section * section);
+    static void removeItem(Tables & from, uint64_t id);
+    static void resolveDates(Tables & in, int today);
+
+public:
+    struct DueItem {
+        uint64_t id;
+        int dueDate;            // With its year filled in
+        std::string_view text;
+        Section * section;
+    };
+
+    DueIndex();
+    ~DueIndex();
+    DueIndex(DueIndex const &) = delete;
+    void operator=(DueIndex const &) = delete;
+
+    // How many days ahead the Upcoming panel looks, 0 if it is turned off
+    static int upcomingDays();
+
+    // Read every item, on the builder thread
+    void build(Document * document, int today);
+    // Whether a build is running or waiting for sync() to land it
+    bool isBuilding();
+    // Whether a build has finished and is waiting for sync() to land it
+    bool hasFinishedBuild();
+    // Catch up with changes made to the Document since the last call
+    void sync(Document * document, int today);
+    // Items due on or before lastDate, earliest first, at most limit of them.
+    // Their text and section are valid until the next sync().
+    std::vector<DueItem> findDueBy(int lastDate, size_t limit);
+
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "Section.hpp"
+
+// How many edits can be undone when UndoDepth isn't set
+#define DEFAULT_UNDO_DEPTH 100
+
+/*
+ * The EditHistory keeps the list as it was after each edit, for undo and
+ * redo. A snapshot is just a copy of the sections, and copies of a section
+ * share their items until one of them is changed, so each snapshot only
+ * holds its own copy of the sections that edit touched. The oldest
+ * snapshots are dropped once there are more than UndoDepth of them.
+ */
+class EditHistory {
+
+public:
+    struct Snapshot {
+        std::vector<Section> sections;
+        int currentPanel;
+    };
+
+private:
+    std::deque<Snapshot> undoStack;
+    std::vector<Snapshot> redoStack;
+    Snapshot current;
+    size_t depth;
+
+    bool sameAsCurrent(Snapshot & snapshot);
+    void trimToDepth();
+
+public:
+    EditHistory();
+
+    static size_t undoDepth();
+    // False when UndoDepth is 0, in which case nothing is kept
+    bool isEnabled();
+
+    // Start over from this list, forgetting everything before it
+    void reset(Snapshot base);
+    // The list has been edited into this
+    void record(Snapshot next);
+    bool canUndo();
+    bool canRedo();
+    // Step back or forward, returning the list to show. Its current panel is
+    // the one the step changed.
+    Snapshot undo();
+    Snapshot redo();
+
+};
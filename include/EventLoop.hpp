@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <csignal>
+
+#include "vexes.hpp"
+
+/*
+ * The EventLoop is where cascade sleeps. It blocks in poll() until a key is
+ * typed, the terminal is resized, a watched descriptor (the ListWatcher's
+ * inotify one) has something to read, or a deadline armed on a timerfd
+ * passes, so nothing runs at all while nothing happens.
+ *
+ * SIGWINCH is blocked and read from a signalfd instead of reaching curses'
+ * own handler. The new size is handed to resizeterm(), which queues
+ * KEY_RESIZE just as that handler would, so a resize still arrives as a key.
+ * Threads inherit the blocked signal, so the EventLoop has to be made before
+ * any of them are started.
+ */
+class EventLoop {
+
+private:
+    int signalFd;
+    int timerFd;
+    sigset_t previousMask;
+
+    void setupSignalFd();
+    void armTimer(std::chrono::steady_clock::time_point deadline);
+    void readResize();
+    void readTimer();
+
+public:
+    EventLoop();
+    ~EventLoop();
+    EventLoop(EventLoop const &) = delete;
+    void operator=(EventLoop const &) = delete;
+
+    // Sleep until there may be a key to read, watchedFd (if not -1) is
+    // readable or deadline passes, time_point::max() for no deadline
+    void waitForEvents(int watchedFd, std::chrono::steady_clock::time_point deadline);
+    // The next key typed into win, or ERR once timeoutMs have passed without
+    // one. A negative timeout waits for as long as it takes.
+    int waitForKey(WINDOW * win, int timeoutMs = -1);
+
+};
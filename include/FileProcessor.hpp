@@ -1,21 +1,39 @@
 #pragma once
 
-#include <fstream>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
-#include "Exceptions.hpp"
+#include "LineScanner.hpp"
+#include "MappedFile.hpp"
 
+// Bytes scanned for line ends in one go
+#define NEWLINE_WINDOW_SIZE     (64 * 1024)
+
+// Hands out the lines of a mapped file as views, without copying them
 class FileProcessor {
 
 private:
-	std::string inputFile;
-	std::ifstream infile;
-	std::string line;
+	std::shared_ptr<MappedFile> file;
+	std::string_view contents;
+	size_t cursor;
+	std::string_view line;
+	std::vector<size_t> newlines;
+	size_t nextNewline;
+	size_t scannedUpTo;
+
+	void advance();
+	size_t findNextNewline();
 
 public:
 	bool isEOF;
 
 	FileProcessor(std::string inputFileIn);
-	std::string poll();
+	FileProcessor(std::shared_ptr<MappedFile> fileIn, std::string_view range);
+	std::string_view poll();
+	std::string_view pollBlock();
+	void skipToSectionHeader();
+	std::shared_ptr<MappedFile> getFile();
 
 };
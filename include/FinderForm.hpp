@@ -0,0 +1,40 @@
+#pragma once
+
+#include "DialogForm.hpp"
+#include "FuzzyFinder.hpp"
+
+// How often the results are redrawn while they are still streaming in
+#define FINDER_POLL_MS 30
+
+/*
+ * The FinderForm is the popup for 'f'. It fuzzy matches what is typed
+ * against every item in the list and shows the best matches above the
+ * input line, redrawing as they stream in from the FuzzyFinder. Up and down
+ * pick a match, Enter jumps to it.
+ */
+class FinderForm : public DialogForm {
+
+private:
+    FuzzyFinder finder;
+    WINDOW * list;
+    int listLines, listColumns;
+    std::vector<FuzzyMatch> shown;
+    int selected;
+    bool chosen;
+    FuzzyMatch choice;
+
+    void placeList();
+    void drawList();
+    void drawCount();
+    void drawResult(FuzzyMatch match, int row, bool isSelected);
+    bool isTypedChar(int ch);
+
+public:
+    FinderForm(State * state);
+    ~FinderForm();
+
+    std::string edit() override;
+    // Where the match picked with Enter is, if one was
+    bool getChoice(int & panelIndex, int & itemIndex);
+
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Document.hpp"
+
+// Items a worker scores before handing its matches over, and the fewest
+// items worth starting workers for. Smaller sets are scored in place.
+#define FUZZY_BATCH_SIZE 4096
+#define FUZZY_PARALLEL_MIN (2 * FUZZY_BATCH_SIZE)
+
+// Scoring, close to fzf's: every matched character is worth the same, with
+// bonuses for starting a word or following the previous match, and
+// penalties for the gaps in between
+#define FUZZY_SCORE_MATCH 16
+#define FUZZY_PENALTY_GAP_START 3
+#define FUZZY_PENALTY_GAP_EXTENSION 1
+#define FUZZY_BONUS_BOUNDARY 8
+#define FUZZY_BONUS_CAMEL_CASE 7
+#define FUZZY_BONUS_CONSECUTIVE 4
+#define FUZZY_FIRST_CHAR_MULTIPLIER 2
+
+struct FuzzyMatch {
+    uint32_t candidate;
+    int score;
+};
+
+/*
+ * The FuzzyFinder matches a query against every item in the Document, as a
+ * subsequence, ignoring case, and ranks what matched. Scoring is split into
+ * batches that worker threads claim from a shared cursor, and the matches
+ * of each batch are visible as soon as it is done, so results stream in
+ * while the rest is scored.
+ *
+ * Every finished query is kept. A query that extends one of them can only
+ * match a subset of what it matched, so only those are scored again, and
+ * taking a character back shows the earlier results without scoring.
+ *
+ * Item text is read in place, so the Document must not change while a
+ * FuzzyFinder exists.
+ */
+class FuzzyFinder {
+
+private:
+    struct Candidate {
+        std::string_view text;
+        uint32_t section;
+        uint32_t position;
+    };
+
+    // A finished query and everything it matched
+    struct Level {
+        std::string query;
+        std::vector<FuzzyMatch> matches;
+    };
+
+    std::vector<Candidate> candidates;
+    std::vector<Level> levels;
+    std::string query;
+    bool done;
+
+    // The query being scored
+    std::vector<std::thread> workers;
+    const std::vector<FuzzyMatch> * source;
+    std::atomic<size_t> cursor;
+    std::atomic<size_t> scanned;
+    std::atomic<int> finishedWorkers;
+    std::atomic<bool> cancelled;
+    std::mutex foundLock;
+    std::vector<FuzzyMatch> found;
+
+    void runWorker();
+    void finishSearch();
+    void stop();
+    size_t getSourceSize();
+    bool ranksBefore(const FuzzyMatch & a, const FuzzyMatch & b);
+    const std::vector<FuzzyMatch> & getResults();
+
+public:
+    FuzzyFinder(Document * document);
+    ~FuzzyFinder();
+    FuzzyFinder(FuzzyFinder const &) = delete;
+    void operator=(FuzzyFinder const &) = delete;
+
+    // Start scoring for a new query, stopping whatever was being scored
+    void search(std::string newQuery);
+    bool isSearching();
+    // Take in a search whose workers have all finished
+    void collect();
+
+    // The best count matches so far, best first. An empty query matches
+    // every item, in list order.
+    std::vector<FuzzyMatch> best(size_t count);
+    size_t getNumMatches();
+    // How much of the current query has been scored, in percent
+    int getProgress();
+    size_t getNumCandidates();
+    std::string_view getText(uint32_t candidate);
+    int getSection(uint32_t candidate);
+    int getPosition(uint32_t candidate);
+    std::string getQuery();
+
+    // Whether text contains the lowercased pattern as a subsequence, and if
+    // so how well it matches, and optionally which characters matched
+    static bool scoreMatch(std::string_view text, std::string_view pattern, int & score,
+                           std::vector<int> * positions = nullptr);
+
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// FNV-1a style hash that consumes eight bytes per step on four independent
+// lanes, used to fingerprint list contents. It is not cryptographic, it only
+// needs to notice changes, and to be fast enough to run on every startup.
+inline uint64_t hashLane(uint64_t lane, const char * bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    lane = (lane ^ word) * 1099511628211ULL;
+
+    return lane ^ (lane >> 32);
+}
+
+inline uint64_t hashBytes(std::string_view bytes) {
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t a = 14695981039346656037ULL;
+    uint64_t b = 0x9e3779b97f4a7c15ULL;
+    uint64_t c = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t d = 0x165667b19e3779f9ULL;
+
+    const char * data = bytes.data();
+    size_t size = bytes.size();
+    size_t i = 0;
+    for(; i + 32 <= size; i += 32) {
+        a = hashLane(a, data + i);
+        b = hashLane(b, data + i + 8);
+        c = hashLane(c, data + i + 16);
+        d = hashLane(d, data + i + 24);
+    }
+
+    uint64_t hash = (((a ^ b) * prime ^ c) * prime ^ d) * prime;
+    for(; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+
+    return (hash ^ size) * prime;
+}
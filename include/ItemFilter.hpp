@@ -0,0 +1,86 @@
+#pragma once
+
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Section.hpp"
+
+/*
+ * An ItemFilter decides which items of a section a panel shows, and maps
+ * the positions of the shown items to their positions in the section. It is
+ * made from what the user typed:
+ *
+ *   /regex/   items the (case-insensitive) regular expression finds
+ *   terms     items matching every term, where the terms are
+ *               #tag       tagged #tag
+ *               !N         priority N or more urgent (!1 is the most)
+ *               @overdue   due before today
+ *               @today     due today
+ *               @week      due in the next seven days, today included
+ *               @due       due at all
+ *             so "#work @week" is everything for work due this week
+ *   anything  items containing it, ignoring case
+ *
+ * A regular expression that doesn't compile is taken as plain text. Terms
+ * are answered from the section's ItemMetadata, not its text.
+ *
+ * The map is the sorted list of the positions of the items that match. The
+ * panel tells the filter about every item it adds, erases, edits or swaps,
+ * so only that one item is tested again. Items behind it only have their
+ * position shifted. Testing every item is only needed when the filter is set
+ * and when the section is replaced wholesale, e.g. by undo or a reload.
+ */
+class ItemFilter {
+
+private:
+    enum Kind {
+        SUBSTRING = 0,
+        REGEX,
+        TERMS,
+    };
+
+    struct Term {
+        char kind;          // '#', '!' or '@'
+        std::string tag;    // Lowercased, without the '#'
+        int priority;
+        int firstDate;      // Due dates from firstDate to lastDate
+        int lastDate;
+    };
+
+    std::string spec;
+    Kind kind;
+    std::string needle;     // Lowercased text to look for
+    std::regex expression;
+    std::vector<Term> terms;
+    int today;
+    std::vector<int> visible;
+
+    bool readTerms();
+    bool readTerm(std::string_view word, Term & term);
+    bool matchesTerm(Section & section, int index, const Term & term);
+    bool matchesText(std::string_view item);
+    void shiftFrom(size_t first, int by);
+
+public:
+    ItemFilter(std::string specIn);
+
+    std::string getSpec();
+    bool matches(Section & section, int index);
+
+    // Test every item of the section again
+    void rebuild(Section & section);
+    void itemInserted(Section & section, int index);
+    void itemErased(int index);
+    void itemChanged(Section & section, int index);
+    void itemsSwapped(int a, int b);
+
+    int getNumVisible();
+    // Position in the section of the item shown at visibleIndex
+    int toItemIndex(int visibleIndex);
+    // Where the item at index is shown, or the next shown item if it isn't
+    int toVisibleIndex(int index);
+    bool isVisible(int index);
+
+};
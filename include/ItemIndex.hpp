@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+struct Section;
+
+// Where an item was last seen. Inserting or erasing items in front of it
+// can leave position behind, which the next lookup corrects, re-registering
+// the whole section once it is more than a little behind.
+struct ItemLocation {
+    Section * section;
+    int position;
+};
+
+/*
+ * The ItemIndex maps item IDs to the section holding them and their position
+ * there. Sections tell the index about every item they add, erase or move,
+ * so it never has to be rebuilt. Until it is activated it ignores all of
+ * that, so lists that never look an item up don't pay for it.
+ */
+class ItemIndex {
+
+private:
+    std::unordered_map<uint64_t, ItemLocation> locations;
+    bool active;
+
+public:
+    ItemIndex();
+    ItemIndex(ItemIndex const &) = delete;
+    void operator=(ItemIndex const &) = delete;
+
+    bool isActive();
+    // Start keeping track of items, the caller adds those that exist already
+    void activate();
+    void add(uint64_t id, Section * section, int position);
+    void remove(uint64_t id);
+    bool find(uint64_t id, ItemLocation & location);
+
+};
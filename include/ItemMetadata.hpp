@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "ChunkedSequence.hpp"
+#include "ItemTokens.hpp"
+
+/*
+ * ItemMetadata keeps what ItemTokens finds in a section's items in columns
+ * beside them: the due date, the priority and where the item's tokens are.
+ * An item is read once, and after that sorting, filtering and drawing only
+ * look at the columns.
+ *
+ * The rows may only cover the first items of the section, with the rest
+ * read when they're first needed. Changes past the last row are ignored.
+ *
+ * The columns are ChunkedSequences, so they are shared between copies of a
+ * section just like its items. Token spans are kept in runs in a pool that
+ * copies share too. The pool only grows: a changed item gets a new run and
+ * its old one is left behind, like replaced text in an ItemArena.
+ */
+class ItemMetadata {
+
+private:
+    ChunkedSequence<int32_t> dueDates;      // yyyymmdd, 0 for none
+    ChunkedSequence<uint8_t> priorities;    // 1 to 9, 0 for none
+    ChunkedSequence<uint32_t> tokenRuns;    // Where the run starts in the pool, 0 for none
+
+    // Each run is a header whose length is the number of tokens that follow
+    std::shared_ptr<std::vector<ItemToken>> pool;
+
+    struct Facts {
+        int32_t dueDate;
+        uint8_t priority;
+        uint32_t tokenRun;
+    };
+
+    Facts read(std::string_view item);
+    void setFacts(size_t index, Facts facts);
+
+public:
+    ItemMetadata();
+
+    // Add a row for the next item
+    void push_back(std::string_view item);
+    // Mirror the same change to the items
+    void insert(size_t index, std::string_view item);
+    void set(size_t index, std::string_view item);
+    void erase(size_t index);
+    // Both rows have to be there
+    void swap(size_t a, size_t b);
+    // Put the rows in the order of positions, as ItemSorter gives them, or
+    // drop them if there isn't one for every item
+    void reorder(const std::vector<int> & positions);
+
+    size_t size() const;
+    int getDueDate(size_t index) const;
+    int getPriority(size_t index) const;
+    // The item's tokens, in order, valid until the section next changes
+    const ItemToken * getTokens(size_t index, int & numTokens) const;
+    // Whether the item, whose text is given, is tagged #tag (tag lowercased)
+    bool hasTag(size_t index, std::string_view item, std::string_view tag) const;
+
+    // Calls visit(dueDate) or visit(priority) for each item in order
+    template <typename Visitor>
+    void visitDueDates(Visitor visit) const {
+        dueDates.visitFrom(0, [&](int32_t dueDate) {
+            visit(dueDate);
+            return true;
+        });
+    }
+
+    template <typename Visitor>
+    void visitPriorities(Visitor visit) const {
+        priorities.visitFrom(0, [&](uint8_t priority) {
+            visit(priority);
+            return true;
+        });
+    }
+
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Section.hpp"
+
+// The fewest items worth sorting on more than one thread
+#define SORT_PARALLEL_MIN (64 * 1024)
+
+/*
+ * The ItemSorter works out the order of a section's items for a SortOrder.
+ * Every item is turned into a collation key once, up front: its lowercased
+ * text for ALPHABETICAL, the same with every run of digits rewritten to
+ * compare by value for NATURAL (so "Week 9" comes before "Week 10"), or the
+ * due date or priority from the section's ItemMetadata for BY_DUE_DATE and
+ * BY_PRIORITY, where items without one go last. The first eight bytes of
+ * each text key are packed into an integer, so most comparisons never look
+ * at the strings at all.
+ *
+ * Equal keys keep the order the items had, so sorting twice changes nothing.
+ * Big sections are split into parts that build their keys and sort on their
+ * own threads, and the parts are then merged pairwise, also in parallel.
+ */
+class ItemSorter {
+
+private:
+    struct Key {
+        uint64_t prefix;
+        std::string_view collated;
+        uint32_t index;
+    };
+
+    static bool comparesText(SortOrder order);
+    static uint64_t makeKey(Section & section, int index, SortOrder order, std::string & collated);
+    static uint64_t makeNumericKey(int value);
+    static uint64_t collate(std::string_view item, bool natural, std::string & collated);
+    static int compareKeys(const Key & a, const Key & b);
+    static bool keyBefore(const Key & a, const Key & b);
+    static void buildPart(std::vector<std::string_view> & items, std::vector<int> & values, SortOrder order,
+                          size_t begin, size_t end, std::vector<Key> & keys, std::string & arena);
+
+public:
+    // The positions of the items in sorted order, i.e. the item that should
+    // go first is at sortedPositions(...)[0]
+    static std::vector<int> sortedPositions(Section & section, SortOrder order);
+    // Where the item at index belongs among the other items of a section
+    // sorted by order, after any equal ones, counted as if it were taken out
+    static int findInsertPosition(Section & section, SortOrder order, int index);
+    // Negative, zero or positive as the item at a goes before, with or
+    // after the item at b
+    static int compareItemsAt(Section & section, int a, int b, SortOrder order);
+
+    // The name sections are saved with ("alpha", ...), and back
+    static std::string getOrderName(SortOrder order);
+    static SortOrder getOrderFromName(std::string_view name);
+
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Items up to this long are kept inside their handle
+#define INLINE_ITEM_BYTES       12
+// How much item text an arena allocates at a time
+#define ITEM_ARENA_BLOCK_BYTES  (256 * 1024)
+
+/*
+ * An ItemRef is the 16 byte handle a section keeps for each item. Short
+ * items are stored in the handle itself. Longer ones point at text that
+ * lives elsewhere, in an ItemArena or in a mapped list file, and whoever
+ * holds the handle keeps that alive.
+ */
+class ItemRef {
+
+private:
+    uint32_t length;
+    char bytes[INLINE_ITEM_BYTES];
+
+public:
+    ItemRef() : length(0) {}
+
+    // A handle to text that outlives it, e.g. a line of a mapped file
+    static ItemRef referTo(std::string_view text) {
+        ItemRef ref;
+        size_t size = text.size();
+        ref.length = (uint32_t)size;
+        if(size <= INLINE_ITEM_BYTES) {
+            memcpy(ref.bytes, text.data(), size);
+        } else {
+            const char * data = text.data();
+            memcpy(ref.bytes, &data, sizeof(data));
+        }
+
+        return ref;
+    }
+
+    bool isInline() const {
+        return length <= INLINE_ITEM_BYTES;
+    }
+
+    std::string_view view() const {
+        if(isInline()) {
+            return std::string_view(bytes, length);
+        }
+
+        const char * data;
+        memcpy(&data, bytes, sizeof(data));
+        return std::string_view(data, length);
+    }
+
+};
+
+/*
+ * An ItemArena holds item text in large blocks, so a section's items take
+ * a handful of allocations rather than one each, and are freed together.
+ * Nothing is freed on its own, text replaced by an edit stays until the
+ * arena goes. Edited text is interned, so the same text is only ever stored
+ * once, while loaded text (mostly unique) is just copied in.
+ */
+class ItemArena {
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed;
+    size_t blockCapacity;
+    size_t bytesStored;
+
+    // Open addressed table of positions in interned, plus one (0 is empty)
+    std::vector<ItemRef> interned;
+    std::vector<uint32_t> table;
+
+    char * allocate(size_t size);
+    void growTable();
+    size_t findSlot(std::string_view text, uint64_t hash);
+
+public:
+    ItemArena();
+    ItemArena(ItemArena const &) = delete;
+    void operator=(ItemArena const &) = delete;
+
+    ItemRef store(std::string_view text);
+    ItemRef intern(std::string_view text);
+    size_t getBytesStored();
+
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <ctime>
+#include <string_view>
+#include <vector>
+
+enum TokenKind : uint8_t {
+    DUE_TOKEN = 1,
+    TAG_TOKEN,
+    PRIORITY_TOKEN,
+};
+
+// Where a token sits in its item's text
+struct ItemToken {
+    uint16_t start;
+    uint16_t length;
+    TokenKind kind;
+};
+
+/*
+ * ItemTokens reads the bits of structure typed into items. Due dates are
+ * written as
+ *
+ *   (Due 12/3)  (Due 12/3/2025)   the form the example list has always used
+ *   @12/3  @12/3/25  @2025-12-03
+ *   2025-12-03                    as a word of its own
+ *
+ * tags as #word, and priorities as !1 (most urgent) to !9, both as words of
+ * their own.
+ *
+ * Dates come back as yyyymmdd. A date without a year has year 0, which
+ * keeps where it sorts from depending on the day the list is opened.
+ * resolveDate() picks its year when it is compared against today.
+ */
+class ItemTokens {
+
+private:
+    static bool isDigit(std::string_view text, size_t at) {
+        return at < text.size() && std::isdigit((unsigned char)text[at]);
+    }
+
+    static bool startsWord(std::string_view text, size_t at) {
+        return at == 0 || std::isspace((unsigned char)text[at - 1]);
+    }
+
+    static bool endsWord(std::string_view text, size_t at) {
+        return at >= text.size() || !std::isalnum((unsigned char)text[at]);
+    }
+
+    // Reads one to maxDigits digits at text[at]
+    static bool readNumber(std::string_view text, size_t & at, int maxDigits, int & value, int & digits) {
+        value = 0;
+        digits = 0;
+        while(digits < maxDigits && isDigit(text, at)) {
+            value = value * 10 + (text[at] - '0');
+            digits++;
+            at++;
+        }
+
+        return digits > 0 && !isDigit(text, at);
+    }
+
+    static bool makeDate(int year, int month, int day, int & date) {
+        if(month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+
+        date = year * 10000 + month * 100 + day;
+        return true;
+    }
+
+    // M/D, M/D/YY or M/D/YYYY
+    static bool readMonthDay(std::string_view text, size_t & at, int & date) {
+        int month, day, year = 0, digits;
+        if(!readNumber(text, at, 2, month, digits) || at >= text.size() || text[at] != '/') {
+            return false;
+        }
+        at++;
+        if(!readNumber(text, at, 2, day, digits)) {
+            return false;
+        }
+        if(at + 1 < text.size() && text[at] == '/' && isDigit(text, at + 1)) {
+            at++;
+            if(!readNumber(text, at, 4, year, digits) || digits == 3) {
+                return false;
+            }
+            if(digits <= 2) {
+                year += 2000;
+            }
+        }
+
+        return makeDate(year, month, day, date);
+    }
+
+    // YYYY-MM-DD
+    static bool readIsoDate(std::string_view text, size_t & at, int & date) {
+        int year, month, day, digits;
+        if(!readNumber(text, at, 4, year, digits) || digits != 4 || at >= text.size() || text[at] != '-') {
+            return false;
+        }
+        at++;
+        if(!readNumber(text, at, 2, month, digits) || at >= text.size() || text[at] != '-') {
+            return false;
+        }
+        at++;
+        if(!readNumber(text, at, 2, day, digits)) {
+            return false;
+        }
+
+        return makeDate(year, month, day, date);
+    }
+
+    // A due date starting at item[at], and where it ends
+    static bool readDueDateAt(std::string_view item, size_t at, int & date, size_t & end) {
+        static const std::string_view legacy = "(Due ";
+        end = at;
+        if(item[at] == '(') {
+            if(item.substr(at, legacy.size()) != legacy) { return false; }
+            end += legacy.size();
+            if(readMonthDay(item, end, date) && end < item.size() && item[end] == ')') {
+                end++;
+                return true;
+            }
+            return false;
+        }
+        if(!startsWord(item, at)) {
+            return false;
+        }
+        if(item[at] == '@') {
+            end++;
+            if(!isDigit(item, end)) { return false; }
+
+            size_t iso = end;
+            if(readIsoDate(item, iso, date) && endsWord(item, iso)) {
+                end = iso;
+                return true;
+            }
+            return readMonthDay(item, end, date) && endsWord(item, end);
+        }
+
+        return isDigit(item, at) && readIsoDate(item, end, date) && endsWord(item, end);
+    }
+
+    static bool readPriorityAt(std::string_view item, size_t at, int & priority) {
+        if(item[at] != '!' || !startsWord(item, at) || at + 1 >= item.size() ||
+           item[at + 1] < '1' || item[at + 1] > '9' || !endsWord(item, at + 2)) {
+            return false;
+        }
+
+        priority = item[at + 1] - '0';
+        return true;
+    }
+
+    // A tag starting at item[at], and where it ends
+    static bool readTagAt(std::string_view item, size_t at, size_t & end) {
+        if(item[at] != '#' || !startsWord(item, at)) {
+            return false;
+        }
+
+        end = at + 1;
+        while(end < item.size() && isTagChar(item[end])) {
+            end++;
+        }
+        return end > at + 1;
+    }
+
+    // Roughly how many days apart two dates are, good enough to compare
+    static int distance(int a, int b) {
+        auto days = [](int date) {
+            return date / 10000 * 372 + date / 100 % 100 * 31 + date % 100;
+        };
+
+        int apart = days(a) - days(b);
+        return apart < 0 ? -apart : apart;
+    }
+
+    static void addToken(std::vector<ItemToken> & tokens, size_t start, size_t end, TokenKind kind) {
+        // Spans are kept small, tokens past what they can hold aren't marked
+        if(end > UINT16_MAX) { return; }
+
+        tokens.push_back(ItemToken{(uint16_t)start, (uint16_t)(end - start), kind});
+    }
+
+public:
+    static bool isTagChar(char ch) {
+        return std::isalnum((unsigned char)ch) || ch == '-' || ch == '_';
+    }
+
+    // Every token in the item, in one pass. date and priority are the first
+    // ones found, or 0.
+    static void findTokens(std::string_view item, int & date, int & priority, std::vector<ItemToken> & tokens) {
+        date = 0;
+        priority = 0;
+
+        size_t numChars = item.size();
+        size_t at = 0;
+        while(at < numChars) {
+            // Most characters can't start a token, so look at those first
+            char ch = item[at];
+            if(ch != '(' && ch != '@' && ch != '!' && ch != '#' && (ch < '0' || ch > '9')) {
+                at++;
+                continue;
+            }
+
+            int value;
+            size_t end;
+            if((ch == '(' || ch == '@' || ch >= '0') && readDueDateAt(item, at, value, end)) {
+                if(date == 0) { date = value; }
+                addToken(tokens, at, end, DUE_TOKEN);
+                at = end;
+            } else if(ch == '!' && readPriorityAt(item, at, value)) {
+                if(priority == 0) { priority = value; }
+                addToken(tokens, at, at + 2, PRIORITY_TOKEN);
+                at += 2;
+            } else if(ch == '#' && readTagAt(item, at, end)) {
+                addToken(tokens, at, end, TAG_TOKEN);
+                at = end;
+            } else if(ch >= '0' && ch <= '9') {
+                // Tokens start words, so the rest of this one can be skipped
+                while(at < numChars && std::isalnum((unsigned char)item[at])) {
+                    at++;
+                }
+            } else {
+                at++;
+            }
+        }
+    }
+
+    // The first due date in the item, or 0
+    static int findDueDate(std::string_view item) {
+        int date, priority;
+        std::vector<ItemToken> tokens;
+        findTokens(item, date, priority, tokens);
+
+        return date;
+    }
+
+    // Today as yyyymmdd, in local time
+    static int today() {
+        time_t now = time(nullptr);
+        struct tm local;
+        localtime_r(&now, &local);
+
+        return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+    }
+
+    // Seconds left until today() moves on to the next day
+    static int secondsUntilTomorrow() {
+        time_t now = time(nullptr);
+        struct tm midnight;
+        localtime_r(&now, &midnight);
+        midnight.tm_mday++;
+        midnight.tm_hour = 0;
+        midnight.tm_min = 0;
+        midnight.tm_sec = 0;
+        midnight.tm_isdst = -1;
+
+        return (int)std::max(mktime(&midnight) - now, (time_t)1);
+    }
+
+    // The date days after (or before) date
+    static int addDays(int date, int days) {
+        struct tm day = {};
+        day.tm_year = date / 10000 - 1900;
+        day.tm_mon = date / 100 % 100 - 1;
+        day.tm_mday = date % 100 + days;
+        day.tm_hour = 12;
+        mktime(&day);
+
+        return (day.tm_year + 1900) * 10000 + (day.tm_mon + 1) * 100 + day.tm_mday;
+    }
+
+    // A date without a year lands in the year that puts it closest to today
+    static int resolveDate(int date, int today) {
+        if(date == 0 || date >= 10000) {
+            return date;
+        }
+
+        int year = today / 10000;
+        int closest = year * 10000 + date;
+        for(int other : {closest - 10000, closest + 10000}) {
+            if(distance(other, today) < distance(closest, today)) {
+                closest = other;
+            }
+        }
+
+        return closest;
+    }
+
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+/*
+ * The LineScanner finds the bytes the list parser cares about (line ends,
+ * blank lines and section headers) 16 or 32 bytes at a time. The widest
+ * kernel the CPU supports (AVX2, then SSE2) is picked the first time it is
+ * used, and a plain byte loop is kept for everything else.
+ */
+class LineScanner {
+
+private:
+    static size_t findPair(std::string_view text, size_t begin, char first, char second);
+
+public:
+    enum Kernel {
+        SCALAR_KERNEL = 0,
+        SSE2_KERNEL,
+        AVX2_KERNEL,
+    };
+
+    // The kernel in use, the widest one the CPU supports unless another was
+    // asked for
+    static Kernel getKernel();
+    // Scan with this kernel from now on (e.g. to compare them), if the CPU
+    // supports it. Not to be called while a list is being parsed.
+    static bool useKernel(Kernel kernel);
+    static const char * getKernelName(Kernel kernel);
+
+    // Appends the offset of every '\n' in text[begin, end) to newlines
+    static void findNewlines(std::string_view text, size_t begin, size_t end, std::vector<size_t> & newlines);
+    // Offset of the first "\n\n" at or after begin, i.e. where a line is
+    // followed by a blank one, or npos if there is none
+    static size_t findBlankLine(std::string_view text, size_t begin);
+    // Offset of the first "\n[" at or after begin, i.e. the newline right
+    // before a section header, or npos if there is none
+    static size_t findSectionHeader(std::string_view text, size_t begin);
+
+};
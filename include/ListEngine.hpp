@@ -1,8 +1,14 @@
 #pragma once
 
+#include <chrono>
+
 #include "CommandFactory.hpp"
+#include "ListIndex.hpp"
 #include "ListParser.hpp"
 
+// How often a save or index build running on another thread is looked in on
+#define BACKGROUND_POLL_MS 50
+
 class ListEngine : public Engine {
 
 private:
@@ -10,12 +16,27 @@ private:
     State * state;
     CommandFactory * commandFactory;
     std::string layoutRatio;
+    std::chrono::milliseconds autosaveDelay;
+    std::chrono::steady_clock::time_point lastAutosave;
 
     void createPanels();
     std::vector<Section> getSectionsFromList();
+    void writeListIndex(ListParser & parser, std::vector<Section> & sections);
+    void replayJournal(std::string_view contents, std::vector<Section> & sections);
+    bool lazyLoadingEnabled();
     std::string convertToAbsolutePath(std::string path);
     bool isRelativePath(std::string path);
     void passPanelsToState(std::vector<SectionPanel *> panels);
+    std::chrono::steady_clock::time_point nextWakeup();
+    void handlePendingInput();
+    void collectFinishedSaves();
+    void autosaveIfDue();
+    std::chrono::milliseconds getAutosaveDelay();
+    void reloadListIfChanged();
+    std::vector<Section> mergeUnsavedEdits(std::vector<Section> & fromDisk, std::vector<int> & standsFor);
+    void rememberMergedSections(std::vector<Section> & fromDisk, std::vector<Section> & merged,
+                                std::vector<int> & standsFor);
+    void reconcilePanels(std::vector<Section> sections);
     void handleInput(int key);
     void renderPanels();
     void renderModeIndicator();
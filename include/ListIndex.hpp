@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Section.hpp"
+
+/*
+ * The ListIndex is the binary sidecar kept next to a list (master.todo ->
+ * master.todo.idx). It records every section's title and color code, where
+ * the section's items live in the list file, and the offset and length of
+ * each item, along with the list's size, mtime and a content checksum. When
+ * all of those still match the list on disk, the sections can be rebuilt
+ * straight from the recorded offsets without parsing any text.
+ *
+ * Layout (native byte order):
+ *   magic "CSCIDX02", u64 size, i64 mtime sec, i64 mtime nsec, u64 checksum,
+ *   u32 section count, then per section:
+ *   u32 title length, title bytes, i32 color code, i32 sort order,
+ *   u64 block offset,
+ *   u64 block length, u32 item count, then (u32 offset, u32 length) per item
+ *   with offsets relative to the start of the block.
+ */
+class ListIndex {
+
+private:
+    struct ItemSpan {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct IndexedSection {
+        std::string title;
+        int32_t colorCode;
+        int32_t sortOrder;
+        uint64_t blockOffset;
+        uint64_t blockLength;
+        std::vector<ItemSpan> items;   // Filled when building an index
+        std::string_view encodedItems; // Raw spans when loaded from disk
+        uint32_t numItems;
+    };
+
+    std::string listPath;
+    uint64_t fileSize;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t checksum;
+    std::vector<IndexedSection> sections;
+    std::unique_ptr<MappedFile> indexFile;
+    bool overflow;
+
+    std::string getIndexPath();
+    bool statList();
+    bool readIndex(std::string_view bytes);
+    bool sectionsFitIn(size_t size);
+    ItemSpan getEncodedSpan(IndexedSection & section, uint32_t index);
+    std::string encode();
+
+public:
+    ListIndex(std::string listPathIn);
+
+    static bool cacheEnabled();
+
+    bool load(std::shared_ptr<MappedFile> list);
+    std::vector<Section> buildSections(std::shared_ptr<MappedFile> list, bool lazily);
+
+    void addSection(std::string title, int colorCode, SortOrder sortOrder, std::string_view contents,
+                    std::string_view block);
+    void addSection(std::string title, int colorCode, SortOrder sortOrder, uint64_t blockOffset);
+    void addItem(uint32_t offset, uint32_t length);
+    void setChecksum(std::string_view contents);
+    void save();
+
+};
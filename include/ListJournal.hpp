@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Section.hpp"
+
+// The journal is folded back into the list once it passes this size, or
+// half the size of the list if that is larger, so rewrites stay rare
+#define JOURNAL_MIN_COMPACT_BYTES (1024*1024)
+
+/*
+ * The ListJournal keeps a log of edits next to a list (master.todo ->
+ * master.todo.journal), so a save only has to append what changed instead
+ * of rewriting the whole list. Each edit is one line, an op character and
+ * its tab separated arguments, with any text last so it can hold tabs:
+ *
+ *   A <section> <item>            add an item to the end of a section,
+ *                                 with its ID after it as in a list
+ *   E <section> <index> <item>    change an item
+ *   D <section> <index>           delete an item
+ *   W <section> <a> <b>           swap two items
+ *   C <section> <color>           change a section's color
+ *   T <section> <title>           change a section's title
+ *   N <color> <title>             add a section at the end
+ *   X <section>                   delete a section
+ *   S <a> <b>                     swap two sections
+ *   O <section> <order> <keep>    sort a section (order 0 leaves the items
+ *                                 as they are), then keep it sorted that
+ *                                 way if keep is 1, or stop keeping it
+ *                                 sorted if it is 0
+ *
+ * In a section kept sorted, added and changed items are moved to where they
+ * belong when replayed, just as they were when the edit was made.
+ *
+ * The first line records the size and checksum of the list the edits were
+ * made against. A journal whose list has since changed is ignored, as is a
+ * torn last line left by a crash.
+ */
+class ListJournal {
+
+private:
+    std::string journalPath;
+    bool enabled;
+    std::string pending;
+    uint64_t journalBytes;
+    uint64_t baseSize;
+    uint64_t baseChecksum;
+    bool fresh;
+    bool compactionRequired;
+
+    std::string makeHeader();
+    bool headerMatches(std::string_view line);
+    bool replayOnto(std::vector<Section> & sections, bool sameBase);
+    bool replayRecord(std::string_view line, std::vector<Section> & sections);
+    void record(char op, std::vector<int> numbers, std::string_view text = std::string_view());
+
+public:
+    ListJournal();
+
+    static bool journalEnabled();
+
+    void attach(std::string listPath, std::string_view baseContents);
+    bool replay(std::vector<Section> & sections);
+    // Replays the journal onto a list someone else has changed since it was
+    // written, e.g. to carry saved edits over a reload. Records are applied
+    // by position, and any that no longer fit stop the replay as usual.
+    bool rebase(std::vector<Section> & sections);
+    bool isEnabled();
+
+    void recordAddItem(int section, std::string_view item, uint64_t id);
+    void recordEditItem(int section, int index, std::string_view item);
+    void recordDeleteItem(int section, int index);
+    void recordSwapItems(int section, int a, int b);
+    void recordColor(int section, int colorCode);
+    void recordTitle(int section, std::string_view title);
+    void recordNewSection(int colorCode, std::string_view title);
+    void recordDeleteSection(int section);
+    void recordSwapSections(int a, int b);
+    void recordSort(int section, SortOrder order, bool keep);
+
+    bool needsCompaction();
+    void requireCompaction();
+    bool hasRecordsOnDisk();
+    // Hands over everything recorded since the last call, with the header in
+    // front if the journal file has to be started over
+    std::string takePendingRecords(bool & truncate);
+    void discardPendingRecords();
+    // The list is being rewritten with these contents, so start a new journal
+    void compactedInto(std::string_view newBase);
+    std::string getPath();
+
+};
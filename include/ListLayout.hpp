@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Section.hpp"
+
+/*
+ * A ListLayout is a list file waiting to be written, kept as a run of pieces
+ * rather than one big string. Text written out for this save (section lines,
+ * changed sections) is collected in one buffer, while unchanged sections are
+ * just ranges of the mapped file they were loaded from, to be copied over by
+ * the writer. It also records where each section's items will land, which is
+ * all the writer needs to index the new file.
+ */
+struct ListLayout {
+
+    struct Piece {
+        std::shared_ptr<MappedFile> source; // Null for pieces of text
+        uint64_t offset;                    // Into source, or into text
+        uint64_t length;
+    };
+
+    struct SectionSpan {
+        std::string title;
+        int colorCode;
+        SortOrder sortOrder;
+        uint64_t blockOffset;
+        uint64_t blockLength;
+    };
+
+    std::string text;
+    std::vector<Piece> pieces;
+    std::vector<SectionSpan> sections;
+    uint64_t size;
+
+    ListLayout();
+
+    void appendText(std::string_view bytes);
+    void appendMapped(std::shared_ptr<MappedFile> source, std::string_view range);
+    void addSection(std::string title, int colorCode, SortOrder sortOrder, uint64_t blockOffset,
+                    uint64_t blockLength);
+    // The whole file as one string
+    std::string flatten();
+
+};
@@ -1,25 +1,47 @@
 #pragma once
 
+#include <atomic>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "FileProcessor.hpp"
 #include "Section.hpp"
 
+// Lists at least this big are parsed on every core
+#define PARALLEL_PARSE_THRESHOLD    (4 * 1024 * 1024)
+// Chunks handed out per thread, so uneven sections still balance out
+#define CHUNKS_PER_THREAD           4
+
 class ListParser {
 
 private:
     FileProcessor * fproc;
+    std::vector<std::string_view> blocks;
+    bool atStartOfFile;
+
+    ListParser(std::shared_ptr<MappedFile> file, std::string_view chunk, bool atStartOfFileIn);
 
-    bool isSectionTitle(std::string line);
-    std::string extractSectionTitle(std::string line);
-    int extractColorCode(std::string line);
-    std::string trimWhitespace(std::string str);
+    bool isSectionTitle(std::string_view line);
+    std::string extractSectionTitle(std::string_view line);
+    int extractColorCode(std::string_view line);
+    SortOrder extractSortOrder(std::string_view line);
+    std::string_view trimWhitespace(std::string_view str);
     Section parseSection(std::string sectionTitle, int sectionColorCode);
-    bool isEndOfSection(std::string line);
+    bool isEndOfSection(std::string_view line);
+    std::vector<Section> parseSections(bool lazily);
+    std::vector<Section> parseListInParallel(unsigned numThreads);
+    std::vector<std::string_view> splitIntoChunks(std::string_view contents, unsigned numChunks);
 
 public:
     ListParser(std::string listPath);
     ~ListParser();
     std::vector<Section> parseList();
+    // Parse on this many threads whatever the list's size, 1 being front to
+    // back (e.g. to see how parsing scales)
+    std::vector<Section> parseList(unsigned numThreads);
+    std::vector<Section> parseListLazily();
+    std::vector<std::string_view> getBlocks();
+    std::shared_ptr<MappedFile> getFile();
 
 };
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Hash.hpp"
+#include "ItemSorter.hpp"
+#include "ListLayout.hpp"
 #include "State.hpp"
 
 class ListSerializer {
@@ -23,22 +26,83 @@ private:
         }
     }
 
+    static void layOutItems(ListLayout & layout, Section & section, bool withIds) {
+        int numItems = section.getNumItems();
+        for(int i = 0; i < numItems; i++) {
+            if(i > 0) {
+                layout.appendText("\n");
+            }
+            layout.appendText(section.getItem(i));
+            if(withIds) {
+                layout.appendText(Section::formatItemId(section.getItemId(i)));
+            }
+        }
+    }
+
+    // [Title] : ColorCode, with the order a kept sorted section is kept in
+    static std::string formatSectionLine(Section & section) {
+        std::string line = "[" + section.title + "] : " + std::to_string(section.colorCode);
+        if(section.sortOrder != UNSORTED) {
+            line += " sort=" + ItemSorter::getOrderName(section.sortOrder);
+        }
+
+        return line + "\n";
+    }
+
 public:
-    static void serializeListToFile(State * state) {
-        std::string listPath = convertToAbsolutePath(state->getListPath());
-        std::ofstream outfile(listPath);
+    // Lays the list out for the writer. Sections are read in place in the
+    // Document, and clean ones are left in their mapping.
+    static ListLayout layOutList(State * state) {
+        ListLayout layout;
+        bool withIds = Section::itemIdsPersisted();
+        Document * document = state->getDocument();
+        int numSections = document->getNumSections();
+        for(int i = 0; i < numSections; i++) {
+            Section & section = *document->getSection(i);
+            layout.appendText(formatSectionLine(section));
 
-        std::vector<Section> sections = state->getSections();
+            uint64_t blockOffset = layout.size;
+            // A block saved without IDs is written out again once they're on
+            bool blockUsable = !withIds || section.originalBlockHasIds();
+            if(section.cleanIfUnchanged() && blockUsable && section.getOrigin()->isUnchangedOnDisk()) {
+                layout.appendMapped(section.getOrigin(), section.getOriginalBlock());
+            } else {
+                layOutItems(layout, section, withIds);
+            }
+            uint64_t blockLength = layout.size - blockOffset;
+            layout.addSection(section.title, section.colorCode, section.sortOrder, blockOffset, blockLength);
 
-        for(Section section : sections) {
-            outfile << "[" << section.title << "] : " << section.colorCode << std::endl;
-            for(std::string item : section.items) {
-                outfile << item << std::endl;
+            // Close off the last item, then the blank line between sections
+            if(blockLength > 0) {
+                layout.appendText("\n");
             }
-            outfile << std::endl;
+            layout.appendText("\n");
+        }
+
+        return layout;
+    }
+
+    // Identifies what a save would write without laying it out. Clean
+    // sections only cost their position, so this is cheap on big lists.
+    static uint64_t fingerprintList(State * state) {
+        const uint64_t prime = 1099511628211ULL;
+        uint64_t fingerprint = 14695981039346656037ULL;
+        Document * document = state->getDocument();
+        int numSections = document->getNumSections();
+        for(int i = 0; i < numSections; i++) {
+            Section & section = *document->getSection(i);
+            section.cleanIfUnchanged();
+            fingerprint = (fingerprint ^ hashBytes(section.title)) * prime;
+            fingerprint = (fingerprint ^ (uint64_t)section.colorCode) * prime;
+            fingerprint = (fingerprint ^ (uint64_t)section.sortOrder) * prime;
+            fingerprint = (fingerprint ^ section.getFingerprint()) * prime;
         }
 
-        outfile.close();
+        return (fingerprint ^ (uint64_t)numSections) * prime;
+    }
+
+    static std::string getAbsoluteListPath(State * state) {
+        return convertToAbsolutePath(state->getListPath());
     }
 
 };
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ * The ListWatcher tells the engine when something other than cascade has
+ * written the list file. It watches the list's directory with inotify, so
+ * editors that save by writing a new file and renaming it over the list are
+ * caught as well as tools that write in place or append. Each change is
+ * compared against the size and mtime the list had when we last read or
+ * wrote it, so our own saves are never reported back to us.
+ */
+class ListWatcher {
+
+private:
+    struct ListStamp {
+        uint64_t size;
+        int64_t mtimeSec;
+        int64_t mtimeNsec;
+    };
+
+    std::string listPath;
+    std::string listName;
+    int inotifyFd;
+    int watchDescriptor;
+    ListStamp stamp;
+
+    void startWatching();
+    bool drainEvents();
+    bool readStamp(ListStamp & current);
+    bool stampHasChanged();
+
+public:
+    ListWatcher(std::string listPathIn);
+    ~ListWatcher();
+    ListWatcher(ListWatcher const &) = delete;
+    void operator=(ListWatcher const &) = delete;
+
+    // True once per external change to the list since the last call
+    bool listHasChanged();
+    // Record the list as it is on disk now, e.g. right after saving it
+    void acknowledgeChanges();
+    int getFd();
+
+};
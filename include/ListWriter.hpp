@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ListLayout.hpp"
+
+/*
+ * The ListWriter saves lists on its own thread, so the UI never waits on the
+ * disk. Each save hands over a ListLayout of the new file; the writer puts
+ * it in a temp file next to the list (copying unchanged ranges straight
+ * from the old file where it can), fsyncs it and renames it over the list,
+ * so the list on disk is always either the old version or the new one. The
+ * index is rebuilt from the new file on this thread too. Saves that pile up
+ * while one is being written are collapsed into the newest. Journal appends
+ * are queued behind them in order, and run together when they pile up.
+ * Finished saves are collected by the main loop through pollCompleted(),
+ * which is where they should be marked as saved.
+ */
+class ListWriter {
+
+private:
+    struct SaveJob {
+        std::string path;        // The list, or the journal for appends
+        ListLayout layout;       // What a rewrite writes
+        std::string records;     // What an append appends
+        std::string journalPath; // Journal made obsolete by a rewrite
+        bool append;
+        bool truncate;
+        uint64_t generation;
+    };
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<SaveJob>> pending;
+    bool writing;
+    bool finishedSave;
+    uint64_t finishedGeneration;
+    bool failedSave;
+    bool journalBroken;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+    bool writeJob(SaveJob & job);
+    void finishJob(SaveJob & job, bool succeeded);
+    static bool writeDurably(std::string listPath, ListLayout & layout);
+    static bool writeLayout(int fd, ListLayout & layout);
+    static bool copyRange(int fd, MappedFile & source, uint64_t offset, uint64_t length);
+    static void writeIndex(std::string listPath, ListLayout & layout);
+    static bool appendDurably(std::string journalPath, std::string & records, bool truncate);
+    static bool writeAll(int fd, std::string_view contents);
+    static std::string resolvePath(std::string path);
+    static void syncDirectory(std::string path);
+
+public:
+    ListWriter();
+    ~ListWriter();
+    ListWriter(ListWriter const &) = delete;
+    void operator=(ListWriter const &) = delete;
+
+    // Queue a full rewrite of the list, replacing anything not yet started.
+    // A journal path given here is removed once the new list is in place.
+    void save(std::string listPath, ListLayout layout, uint64_t generation, std::string journalPath = "");
+    // Queue records to be appended to a journal, starting it over first if
+    // truncate is set
+    void append(std::string journalPath, std::string records, bool truncate, uint64_t generation);
+    // True if a save has landed since the last call, along with the change
+    // generation its contents were taken at
+    bool pollCompleted(uint64_t & generation);
+    // True once for every run of failed saves. After a failed append, later
+    // appends fail too until a full rewrite has gone through.
+    bool pollFailed();
+    // True while a save is queued or being written
+    bool isBusy();
+
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Exceptions.hpp"
+
+/*
+ * The MappedFile maps a whole file into memory read-only, so that callers can
+ * scan it as a single std::string_view instead of copying it line by line
+ * through an ifstream. The mapping lives exactly as long as the object does,
+ * and so does an open descriptor, which lets saves copy unchanged ranges of
+ * the file in the kernel even after the list has been replaced on disk.
+ */
+class MappedFile {
+
+private:
+	std::string path;
+	int fd;
+	const char * data;
+	size_t size;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+
+	void mapFile();
+	void unmapFile();
+
+public:
+	MappedFile(std::string pathIn);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+	void operator=(MappedFile const &) = delete;
+
+	std::string_view getContents();
+	size_t getSize();
+	int getFd();
+	// False once something has rewritten the file in place, which also
+	// changes what the mapping reads
+	bool isUnchangedOnDisk();
+
+};
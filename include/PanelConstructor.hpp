@@ -1,67 +1,169 @@
 #pragma once
 
+#include "Document.hpp"
+#include "DueIndex.hpp"
 #include "SectionPanel.hpp"
 
 class PanelConstructor {
 
 private:
-    static std::vector<Box> generateLayoutFromSections(std::vector<Section> sections) {
-        int numSections = (int)sections.size();
-        std::string ratioString = "";
-        for(int i = 0; i < numSections; i++) {
-            ratioString = ratioString + "1:";
+    static std::string removeTrailingColon(std::string ratioString) {
+        std::string trimmed = ratioString.substr(0, ratioString.size() - 1);
+
+        return trimmed;
+    }
+
+    static Box generateLayoutBounds() {
+        // The Upcoming panel, when there is one, takes the top
+        int top = DueIndex::upcomingDays() > 0 ? UPCOMING_PANEL_LINES : 0;
+        Point ul(0, top); Point lr(COLS - 1, LINES - 2);
+        Box bounds(ul, lr);
+
+        return bounds;
+    }
+
+    static std::vector<SectionPanel *> populatePanels(Document * document, std::vector<Box> layout) {
+        std::vector<SectionPanel *> panels;
+        int numPanels = document->getNumSections();
+        for(int i = 0; i < numPanels; i++) {
+            SectionPanel * panel = new SectionPanel(layout[i], document->getSection(i));
+            panels.push_back(panel);
         }
 
-        ratioString = removeTrailingColon(ratioString);
-        Box layoutBounds = generateLayoutBounds();
-        std::vector<Box> layout;
+        return panels;
+    }
 
-        if(ratioString == "1") {
-            layout.push_back(layoutBounds);
-            
-            return layout;
+    static void relocatePanels(std::vector<SectionPanel *> & panels, std::vector<Box> & layout) {
+        int numPanels = (int)panels.size();
+        for(int i = 0; i < numPanels; i++) {
+            panels[i]->relocate(layout[i]);
         }
+    }
+
+    static int findPanelForSection(std::vector<SectionPanel *> & panels, std::vector<bool> & claimed,
+                                   Section & section, bool & unchanged) {
+        // Prefer a panel already showing exactly this section, then any
+        // panel with the same title, so renamed or new sections get new ones
+        int numPanels = (int)panels.size();
+        int sameTitle = -1;
+        unchanged = false;
+        for(int i = 0; i < numPanels; i++) {
+            if(claimed[i] || panels[i]->getSectionTitle() != section.title) {
+                continue;
+            }
+            if(panels[i]->showsSection(section)) {
+                unchanged = true;
+                return i;
+            }
+            if(sameTitle < 0) {
+                sameTitle = i;
+            }
+        }
+
+        return sameTitle;
+    }
+
+public:
+    static Box generateUpcomingBounds() {
+        Point ul(0, 0); Point lr(COLS - 1, UPCOMING_PANEL_LINES - 1);
+        Box bounds(ul, lr);
+
+        return bounds;
+    }
+
+    static std::vector<SectionPanel *> constructPanelsForDocument(Document * document) {
+        std::vector<SectionPanel *> panels;
 
         try {
-            layout = Layouts::customVLayout(ratioString, &layoutBounds);
+            std::vector<Box> layout = generateLayoutForCount(document->getNumSections());
+            panels = populatePanels(document, layout);
         } catch(InvalidRatioException& e) {
             throw InvalidRatioException(e.what());
         }
 
-        return layout;
+        return panels;
     }
 
-    static std::string removeTrailingColon(std::string ratioString) {
-        std::string trimmed = ratioString.substr(0, ratioString.size() - 1);
-
-        return trimmed;
+    // Fit the panels to the screen again, e.g. after a resize or after
+    // sections were moved or removed. Only panels whose box changed are
+    // touched.
+    static void relayoutPanels(std::vector<SectionPanel *> panels) {
+        try {
+            std::vector<Box> layout = generateLayoutForCount((int)panels.size());
+            relocatePanels(panels, layout);
+        } catch(InvalidRatioException& e) {
+            throw InvalidRatioException(e.what());
+        }
     }
 
-    static Box generateLayoutBounds() {
-        Point ul(0, 0); Point lr(COLS - 1, LINES - 2);
-        Box bounds(ul, lr);
+    // Add a panel for a section just added to the end of the document
+    static std::vector<SectionPanel *> addPanelForSection(std::vector<SectionPanel *> panels, Section * section) {
+        try {
+            std::vector<Box> layout = generateLayoutForCount((int)panels.size() + 1);
+            panels.push_back(new SectionPanel(layout.back(), section));
+            relocatePanels(panels, layout);
+        } catch(InvalidRatioException& e) {
+            throw InvalidRatioException(e.what());
+        }
 
-        return bounds;
+        return panels;
     }
 
-    static std::vector<SectionPanel *> populatePanels(std::vector<Section> sections, std::vector<Box> layout) {
-        std::vector<SectionPanel *> panels;
-        int numPanels = (int)sections.size();
+    static std::vector<Box> generateLayoutForCount(int numPanels) {
+        std::string ratioString = "";
         for(int i = 0; i < numPanels; i++) {
-            SectionPanel * panel = new SectionPanel(layout[i], sections[i]);
-            panels.push_back(panel);
+            ratioString = ratioString + "1:";
         }
 
-        return panels;
+        ratioString = removeTrailingColon(ratioString);
+        Box layoutBounds = generateLayoutBounds();
+        std::vector<Box> layout;
+
+        if(ratioString == "1") {
+            layout.push_back(layoutBounds);
+
+            return layout;
+        }
+
+        try {
+            layout = Layouts::customVLayout(ratioString, &layoutBounds);
+        } catch(InvalidRatioException& e) {
+            throw InvalidRatioException(e.what());
+        }
+
+        return layout;
     }
 
-public:
-    static std::vector<SectionPanel *> constructPanelsFromSections(std::vector<Section> sections) {
+    // Bring existing panels in line with a freshly loaded list. Panels whose
+    // section is unchanged are kept as they are (only moved if the layout
+    // shifted), changed ones are updated in place, and new sections are
+    // added to the document with new panels. Panels left out of the result
+    // are no longer needed.
+    static std::vector<SectionPanel *> reconcilePanelsWithSections(std::vector<SectionPanel *> oldPanels,
+                                                                   std::vector<Section> & sections,
+                                                                   Document * document) {
         std::vector<SectionPanel *> panels;
 
         try {
-            std::vector<Box> layout = generateLayoutFromSections(sections);
-            panels = populatePanels(sections, layout);
+            std::vector<Box> layout = generateLayoutForCount((int)sections.size());
+            std::vector<bool> claimed(oldPanels.size(), false);
+            int numSections = (int)sections.size();
+            for(int i = 0; i < numSections; i++) {
+                bool unchanged;
+                int match = findPanelForSection(oldPanels, claimed, sections[i], unchanged);
+                if(match < 0) {
+                    panels.push_back(new SectionPanel(layout[i], document->addSection(sections[i])));
+                    continue;
+                }
+
+                SectionPanel * panel = oldPanels[match];
+                claimed[match] = true;
+                if(!unchanged) {
+                    panel->updateSection(sections[i]);
+                }
+                panel->relocate(layout[i]);
+                panels.push_back(panel);
+            }
         } catch(InvalidRatioException& e) {
             throw InvalidRatioException(e.what());
         }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "DialogForm.hpp"
+
+/*
+ * The SearchForm is the input line for '/'. It searches as you type and
+ * highlights the matches in the panels behind it. A query that only extends
+ * the last one is answered by checking the last matches again, rather than
+ * searching the whole list.
+ */
+class SearchForm : public DialogForm {
+
+private:
+    std::string lastQuery;
+    std::vector<uint64_t> lastMatches;
+
+protected:
+    void inputChanged() override;
+
+public:
+    SearchForm(State * state);
+
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Document.hpp"
+#include "SectionTracker.hpp"
+
+// Queries shorter than a trigram can't use the index, so they are only run
+// when submitted, by scanning every item
+#define SEARCH_MIN_INDEXED_QUERY 3
+// The index is rebuilt once more than this many of its items are stale, and
+// they outnumber the live ones
+#define SEARCH_MIN_STALE_ITEMS 4096
+
+// The search the panels show: its query, lowercased, and the items it matched
+struct SearchMatches {
+    std::string query;
+    std::unordered_set<uint64_t> ids;
+};
+
+/*
+ * The SearchIndex is an in-memory trigram index over the text of every item
+ * in the Document, for case-insensitive substring search. Each lowercased
+ * trigram maps to a posting list of the items containing it, kept as
+ * ascending varint deltas. A query intersects the lists of its trigrams,
+ * starting from the shortest, and checks the few candidates left against
+ * their text. That text is read in place, from the copies of the sections
+ * the SectionTracker keeps, which keep it alive.
+ *
+ * Items are numbered in the order they were indexed. A changed item is
+ * indexed again under a new number and its old number is left dead, so
+ * posting lists are only ever appended to. Once dead numbers outnumber live
+ * ones the index is rebuilt.
+ *
+ * The first build runs on the tracker's thread and lands the next time the
+ * index is used. After that, sync() brings the index up to date with the
+ * Document, looking only at the items the tracker says may have changed.
+ */
+class SearchIndex {
+
+private:
+    struct Posting {
+        std::vector<uint8_t> deltas;
+        uint32_t trigram;
+        uint32_t last;
+        uint32_t count;
+    };
+
+    struct Doc {
+        uint32_t number;
+        uint32_t stamp;
+        uint64_t textHash;
+    };
+
+    // Open addressing, from trigram to its place in postings
+    struct Slot {
+        uint32_t trigram;
+        uint32_t posting;
+    };
+
+    struct Tables {
+        std::vector<Slot> slots;
+        std::vector<Posting> postings;
+        std::vector<uint64_t> ids;              // Item ID by number, 0 once dead
+        std::vector<std::string_view> texts;    // Item text by number
+        std::unordered_map<uint64_t, Doc> docs; // Live number by item ID
+        uint32_t deadDocs;
+        uint32_t stamp;
+
+        Tables() : deadDocs(0), stamp(0) {}
+    };
+
+    std::unique_ptr<Tables> tables;
+    std::unique_ptr<Tables> built;
+    SectionTracker tracker;
+
+    void startBuild(Document * document);
+    void runBuild();
+    void finishBuild(Document * document);
+    void stopBuild();
+
+    static void addDoc(Tables & into, uint64_t id, std::string_view text, uint64_t textHash);
+    static void removeDoc(Tables & from, uint64_t id);
+    static Posting * findPosting(Tables & in, uint32_t trigram, bool create);
+    static void growSlots(Tables & in);
+    static void appendPosting(Posting & posting, uint32_t number);
+    static std::vector<uint32_t> decodePosting(const Posting & posting);
+    static std::vector<uint32_t> intersectPosting(const std::vector<uint32_t> & candidates,
+                                                  const Posting & posting);
+    static void collectTrigrams(std::string_view text, std::vector<uint32_t> & trigrams);
+
+    std::vector<uint64_t> scanAll(Document * document, std::string_view query);
+
+public:
+    SearchIndex();
+    ~SearchIndex();
+    SearchIndex(SearchIndex const &) = delete;
+    void operator=(SearchIndex const &) = delete;
+
+    // Index every item, on the builder thread
+    void build(Document * document);
+    // Catch up with changes made to the Document since the last call
+    void sync(Document * document);
+    // IDs of the items containing query, in no particular order
+    std::vector<uint64_t> find(Document * document, std::string_view query);
+    // The same, for a query that extends the one that found previous
+    std::vector<uint64_t> refine(std::vector<uint64_t> & previous, std::string_view query);
+
+    static std::string lowercase(std::string_view text);
+    // Where loweredQuery first appears in text, ignoring case, or npos
+    static size_t findIgnoringCase(std::string_view text, std::string_view loweredQuery);
+
+};
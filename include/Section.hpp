@@ -1,19 +1,207 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
-// Each section keeps track of its own internals
+#include "ChunkedSequence.hpp"
+#include "ItemIndex.hpp"
+#include "ItemMetadata.hpp"
+#include "ItemStore.hpp"
+#include "MappedFile.hpp"
+
+// Marks the ID saved after an item's text, as in "Buy milk\t@id=<hex>"
+#define ITEM_ID_MARKER "\t@id="
+
+// The order a section can be kept sorted in, see ItemSorter
+enum SortOrder {
+    UNSORTED = 0,
+    ALPHABETICAL,
+    NATURAL,
+    BY_DUE_DATE,
+    BY_PRIORITY,
+};
+
+/*
+ * Each section keeps track of its own internals. Items are ItemRef handles,
+ * with their text in the section's ItemArena. A section can be loaded
+ * lazily, in which case it only knows the block of the mapped list file its
+ * items live in, and lines are indexed the first time something asks for
+ * them. Lazily loaded items point straight into the mapping, so they can't
+ * be read once another program rewrites the file in place.
+ *
+ * Sections loaded from a file also remember the block their items came from.
+ * Until the items are changed the section is clean, and a save can copy that
+ * block as it is instead of writing the items out again. Once another
+ * program rewrites the file in place the block is forgotten, and the
+ * section is dirty from then on.
+ *
+ * Copying a section is cheap, copies share their items until one of them
+ * changes, at which point it takes its own copy. Items are kept in a
+ * ChunkedSequence, so even for huge sections that copy only takes the chunk
+ * list, and items can be erased or inserted anywhere without shifting the
+ * rest.
+ *
+ * Every item has a 64 bit ID that stays with it through edits, moves and
+ * undo. IDs are read back from lists that were saved with them, and new
+ * ones are picked at random so they won't clash with those. A section kept
+ * in a Document reports its items to the Document's ItemIndex; copies of it
+ * don't.
+ *
+ * Due dates, priorities and tags in items are read the first time they are
+ * asked for, and kept in an ItemMetadata beside the items.
+ *
+ * A section can be kept sorted. Its items are then placed where they belong
+ * as they are added or changed, by a binary search, instead of sorting the
+ * whole section again.
+ */
 struct Section {
 
     std::string title;
     int colorCode;
-    std::vector<std::string> items;
+    SortOrder sortOrder;    // UNSORTED unless the section is kept sorted
 
-    Section(std::string titleIn, int colorCodeIn) :
-        title(titleIn), colorCode(colorCodeIn) {}
+    Section(std::string titleIn, int colorCodeIn);
+    Section(std::string titleIn, int colorCodeIn,
+            std::shared_ptr<MappedFile> sourceIn, std::string_view blockIn);
+    // Copies and moved-to sections report to no index, so moving can't throw
+    Section(const Section & other);
+    Section(Section && other) noexcept;
+    // Assigning keeps the section reporting to the index it reported to,
+    // which allocates, so even a move can throw
+    Section & operator=(const Section & other);
+    Section & operator=(Section && other);
 
-    void addItem(std::string itemIn) {
-        items.push_back(itemIn);
+    // True if saves should write item IDs (PersistItemIds)
+    static bool itemIdsPersisted();
+    // ITEM_ID_MARKER followed by the ID
+    static std::string formatItemId(uint64_t id);
+
+    void addItem(std::string_view itemIn);
+    void addItem(std::string_view itemIn, uint64_t id);
+    // Adds an item read from a list or journal, which is copied without
+    // interning and keeps the ID saved with it, if there is one
+    void loadItem(std::string_view itemIn);
+    std::string_view getItem(int index);
+    uint64_t getItemId(int index);
+    // Position of the item with this ID at most radius items from hint, or
+    // -1. Nearby items are found quickest.
+    int findItemById(uint64_t id, int hint, int radius);
+    void setItem(int index, std::string_view item);
+    void insertItem(int index, std::string_view item);
+    void insertItem(int index, std::string_view item, uint64_t id);
+    void eraseItem(int index);
+    void swapItems(int a, int b);
+    // Put the items in order, returning where each item came from
+    std::vector<int> sortItems(SortOrder order);
+    // Move the item at index to where sortOrder puts it, if it isn't there
+    // already, and return its position
+    int keepItemInOrder(int index);
+    int getNumItems();
+    bool hasItemAt(int index);
+    // What was read from the item at index, see ItemTokens
+    int getDueDate(int index);
+    int getPriority(int index);
+    const ItemToken * getItemTokens(int index, int & numTokens);
+    bool itemHasTag(int index, std::string_view tag);
+    // The columns for every item, once they are all indexed
+    const ItemMetadata & getMetadata();
+    // Read the items past the last row of rows into it, leaving the section
+    // as it is, so a copy can be read on another thread
+    void describeInto(ItemMetadata & rows);
+    // Take rows read from copy, if this section hasn't changed since and
+    // hasn't read as many itself
+    void adoptMetadata(Section & copy, ItemMetadata & rows);
+    int countItemsUpTo(int limit);
+    void prefetchItems(int first, int last);
+    bool isLazy();
+    // True once the file lazily loaded items point into has been rewritten
+    // in place, after which nothing may be read from the section
+    bool sourceChangedOnDisk();
+    // Never true for a section that can't be read any more
+    bool hasSameContentsAs(Section & other);
+    bool sharesContentsWith(Section & other);
+    // Whether neither has had its items changed since one was copied from
+    // the other, whatever became of their titles
+    bool sharesItemsWith(Section & other);
+
+    // Report items to this index from now on, or stop doing so
+    void attachIndex(ItemIndex * index);
+    void detachIndex();
+    // Tell the attached index about every item indexed so far
+    void registerItems();
+    // Calls visit(id, text, index) for each indexed item, or with another
+    // copy given, only for items in chunks that copy doesn't share
+    template <typename Visitor>
+    void visitItemsNotIn(Section * other, Visitor visit) {
+        auto visitEntry = [&](const Entry & entry, size_t index) {
+            visit(entry.id, entry.text.view(), (int)index);
+        };
+        if(other == nullptr) {
+            size_t index = 0;
+            contents->items.visitFrom(0, [&](const Entry & entry) {
+                visitEntry(entry, index++);
+                return true;
+            });
+        } else if(contents != other->contents) {
+            contents->items.visitUnsharedWith(other->contents->items, visitEntry);
+        }
     }
 
+    void attachOrigin(std::shared_ptr<MappedFile> originIn, std::string_view blockIn);
+    bool isDirty();
+    bool cleanIfUnchanged();
+    std::shared_ptr<MappedFile> getOrigin();
+    std::string_view getOriginalBlock();
+    // True if the original block saved an ID with every item, false once
+    // there is no block to read
+    bool originalBlockHasIds();
+    uint64_t getFingerprint();
+
+private:
+    struct Entry {
+        ItemRef text;
+        uint64_t id;
+    };
+
+    // Everything but the title and color lives here, shared between copies
+    // of the section (e.g. undo snapshots) until one of them is changed
+    struct Contents {
+        ChunkedSequence<Entry> items;
+        ItemMetadata metadata;      // Rows for the first items
+        std::shared_ptr<ItemArena> arena;
+
+        // The file lazily loaded items point into until the section is first
+        // changed, and the part of its block not split into items yet
+        std::shared_ptr<MappedFile> source;
+        std::string_view pending;
+
+        // Where the items were loaded from, kept after they are changed so
+        // the section can tell when it has been changed back
+        std::shared_ptr<MappedFile> origin;
+        std::string_view originalBlock;
+        bool dirty;
+        uint64_t fingerprint;
+        bool fingerprintValid;
+        bool blockIdsChecked;
+        bool blockHasIds;
+    };
+
+    std::shared_ptr<Contents> contents;
+    ItemIndex * itemIndex;
+
+    void detach();
+    void beginChange();
+    void markDirty();
+    void dropChangedOrigin();
+    bool itemsMatchOriginal();
+    ItemArena & itemArena();
+    void indexThrough(int index);
+    void indexAll();
+    void describeThrough(int index);
+    void unregisterItems();
+    void pushItem(ItemRef text, uint64_t id);
+
 };
@@ -1,17 +1,33 @@
 #pragma once
 
+#include <memory>
+
 #include "vexes.hpp"
 
+#include "ItemFilter.hpp"
+#include "SearchIndex.hpp"
 #include "Section.hpp"
 
+// How far a reload looks for the highlighted item after the list changed
+#define RELOAD_SEARCH_RADIUS 512
+
+/*
+ * A SectionPanel draws one section. With a filter set it only shows the
+ * items matching it, and highlightIndex, firstItemIndex and lastItemIndex
+ * count shown items. Everything public takes and returns positions in the
+ * section itself.
+ */
 class SectionPanel : public Panel {
 
 private:
-    Section section;
+    Section * section;      // Owned by the Document
     int sectionColor;
     int highlightIndex;
     int firstItemIndex;
     int lastItemIndex;
+    SearchMatches * searchMatches;  // Owned by the State
+    std::unique_ptr<ItemFilter> filter;
+    bool dirty;             // Changed since it was last drawn
 
     int convertColorCodeToAttribute(int code);
     void drawTitleBar();
@@ -25,29 +41,67 @@ private:
     void drawUpperIndicators();
     void drawLowerIndicators();
     void drawItemsWithHighlight();
-    std::string truncateStringByLength(std::string str, int length);
-    void resetIndices();
+    void drawTokens(std::string_view item, std::string truncItem, int index, int offset);
+    void drawSearchMatch(std::string_view item, std::string truncItem, int index, int offset);
+    void prefetchNeighbouringItems();
+    std::string truncateStringByLength(std::string_view str, int length);
+    int findItemNear(std::string item, int index);
+    void keepHighlightInView();
+    void keepHighlightOnItem();
+    void followItem(int itemIndex);
+    void placeAddedItem();
+    int countShownItems();
+    int countShownItemsUpTo(int bound);
+    bool hasShownItemAt(int index);
+    int toItemIndex(int shownIndex);
+    int toShownIndex(int itemIndex);
 
 public:
-    SectionPanel(Box globalDimensionsIn, Section sectionIn);
+    SectionPanel(Box globalDimensionsIn, Section * sectionIn);
 
     void drawPanel() override;
     void drawPanelFocused();
+    // Whether the panel has to be drawn again. Everything that changes what
+    // it shows marks it, drawing it clears the mark.
+    bool isDirty();
+    void markDirty();
     void scrollDown();
     void scrollUp();
     void incrementHighlightIndex();
     void decrementHighlightIndex();
     Section getSection();
+    Section & getSectionRef();
+    Section * getSectionHandle();
     std::string getSectionTitle();
     void setSectionTitle(std::string newTitle);
     std::string getCurrentItem();
+    int getCurrentItemIndex();
+    uint64_t getCurrentItemId();
     void setCurrentItem(std::string item);
     void deleteCurrentItem();
+    // The number of items shown, which a filter may keep below the number
+    // the section holds
     int getNumItems();
-    void addItem(std::string newItem);
+    // Returns the new item's ID, or 0 if nothing was added
+    uint64_t addItem(std::string newItem);
+    // Adds an item that keeps its ID, e.g. one moved from another section
+    void addItem(std::string newItem, uint64_t id);
     void moveToBeginningOfItems();
     void moveToEndOfItems();
     void incrementColorCode();
     void swapItemDown();
     void swapItemUp();
+    // Sort the items (UNSORTED leaves them be), then keep them sorted that
+    // way or stop keeping them sorted. The highlight stays on its item.
+    void sortItems(SortOrder order, bool keep);
+    bool showsSection(Section & other);
+    void updateSection(Section newSection);
+    void relocate(Box newGlobalDimensions);
+    void showSearchMatches(SearchMatches * matches);
+    // Highlight the item at index, scrolling it into view. A filter that
+    // hides it is dropped.
+    void highlightItemAt(int index);
+    // Show only the items matching spec, or all of them for ""
+    void setFilter(std::string spec);
+    std::string getFilter();
 };
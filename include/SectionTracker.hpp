@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Document.hpp"
+#include "ItemMetadata.hpp"
+
+/*
+ * The SectionTracker is how an index over the whole Document (the
+ * SearchIndex, the DueIndex) keeps up with it without reading every item
+ * each time. It keeps a copy of every section as the index last read it,
+ * and since copies share their unchanged chunks, catchUp() only hands over
+ * items in chunks that changed since.
+ *
+ * It also runs the index's first build on a thread of its own. The build
+ * reads copies taken beforehand, which become the tracked copies once it
+ * is finished. A build may read the copies' metadata as well, and sections
+ * still unchanged when it lands take that over instead of reading their
+ * items again.
+ */
+class SectionTracker {
+
+private:
+    struct Tracked {
+        Section * handle;
+        Section snapshot;
+        ItemMetadata described;     // Read by the build, for handle to take
+    };
+
+    std::vector<Tracked> tracked;
+    std::vector<Tracked> building;
+
+    std::thread builder;
+    std::atomic<bool> buildDone;
+    std::atomic<bool> cancelled;
+
+public:
+    SectionTracker();
+    ~SectionTracker();
+    SectionTracker(SectionTracker const &) = delete;
+    void operator=(SectionTracker const &) = delete;
+
+    // Copy every section for a build, returning how many items they hold
+    size_t prepareBuild(Document * document);
+
+    // Call build() on the builder thread, once prepareBuild() has been
+    template <typename Build>
+    void startBuild(Build build) {
+        buildDone = false;
+        cancelled = false;
+        builder = std::thread([this, build]() {
+            build();
+            buildDone = true;
+        });
+    }
+
+    // From the build: calls visit(section, id, text) for every item in the
+    // copies, stopping between sections once the build is cancelled
+    template <typename Visitor>
+    void visitBuildItems(Visitor visit) {
+        for(Tracked & entry : building) {
+            if(cancelled) { return; }
+
+            Section * section = entry.handle;
+            entry.snapshot.visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view text, int index) {
+                visit(section, id, text);
+            });
+        }
+    }
+
+    // The same, reading each copy's metadata first and calling
+    // visit(section, id, text, metadata, index)
+    template <typename Visitor>
+    void visitDescribedBuildItems(Visitor visit) {
+        for(Tracked & entry : building) {
+            if(cancelled) { return; }
+
+            Section * section = entry.handle;
+            const ItemMetadata & metadata = entry.described;
+            entry.snapshot.describeInto(entry.described);
+            entry.snapshot.visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view text, int index) {
+                visit(section, id, text, metadata, index);
+            });
+        }
+    }
+
+    // Whether a build is running or waiting for finishBuild()
+    bool isBuilding();
+    bool hasFinishedBuild();
+    // Wait for the build, and track the copies it read from then on
+    void finishBuild(Document * document);
+    // Cancel the build and forget its copies
+    void stopBuild();
+
+    // Calls changed(section, id, text, index) for every item in a chunk
+    // changed since the last call, then stale(id) for every item the tracked
+    // copies had in such a chunk. An item that is still around has been
+    // passed to changed() by then, wherever it went.
+    template <typename Changed, typename Stale>
+    void catchUp(Document * document, Changed changed, Stale stale) {
+        std::unordered_map<Section *, Section *> previous;
+        for(Tracked & entry : tracked) {
+            previous[entry.handle] = &entry.snapshot;
+        }
+
+        std::vector<Tracked> current;
+        std::unordered_set<Section *> live;
+        int numSections = document->getNumSections();
+        current.reserve(numSections);
+        for(int i = 0; i < numSections; i++) {
+            Section * section = document->getSection(i);
+            section->getNumItems();
+            live.insert(section);
+
+            auto found = previous.find(section);
+            Section * before = found == previous.end() ? nullptr : found->second;
+            section->visitItemsNotIn(before, [&](uint64_t id, std::string_view text, int index) {
+                changed(section, id, text, index);
+            });
+
+            current.push_back(Tracked{section, *section, ItemMetadata()});
+        }
+
+        for(Tracked & entry : tracked) {
+            Section * now = live.count(entry.handle) > 0 ? entry.handle : nullptr;
+            entry.snapshot.visitItemsNotIn(now, [&](uint64_t id, std::string_view text, int index) {
+                stale(id);
+            });
+        }
+
+        tracked = std::move(current);
+    }
+
+};
@@ -1,5 +1,15 @@
 #pragma once
 
+#include <chrono>
+
+#include "Document.hpp"
+#include "DueIndex.hpp"
+#include "EditHistory.hpp"
+#include "EventLoop.hpp"
+#include "ListJournal.hpp"
+#include "ListWatcher.hpp"
+#include "ListWriter.hpp"
+#include "SearchIndex.hpp"
 #include "SectionPanel.hpp"
 
 enum Mode {
@@ -7,24 +17,55 @@ enum Mode {
     MOVE,
 };
 
+// A section as the list on disk has it, and the section in the Document it
+// stands for (nullptr once that has been deleted)
+struct SavedSection {
+    Section * handle;
+    Section copy;
+};
+
 class State {
 
 private:
+    Document * document;
 	std::vector<SectionPanel *> panels;
 	int currentPanel;
     std::string listPath;
 	bool exitFlag;
     Mode mode;
     bool unsavedChanges;
+    uint64_t changeGeneration;
+    uint64_t submittedGeneration;
+    uint64_t savedFingerprint;
+    std::vector<SavedSection> savedSections;
+    std::chrono::steady_clock::time_point lastChangeTime;
+    EventLoop * events;
+    ListWatcher * watcher;
+    ListWriter * writer;
+    ListJournal * journal;
+    EditHistory * history;
+    SearchIndex * search;
+    SearchMatches searchMatches;
+    DueIndex * due;
+    Section upcoming;               // What the Upcoming panel shows
+    SectionPanel * upcomingPanel;   // nullptr when it is turned off
+    int upcomingDay;
+    bool modeIndicatorDirty;
 
 	int wrapIndex(int index);
     void resetIndices();
+    void arrangeDocument();
+    void markChanged();
+    void markPanelsDirty();
+    bool upcomingShows(Section & shown);
+    EditHistory::Snapshot takeSnapshot();
 
 public:
 	State(std::string listPathIn);
 	~State();
 	void addPanel(SectionPanel * panel);
 	std::vector<SectionPanel *> getPanels();
+    Document * getDocument();
     int getNumPanels();
     void replacePanels(std::vector<SectionPanel *> newPanels);
 	void setCurrentPanel(int panelIndex);
@@ -38,11 +79,63 @@ public:
 	bool userHasNotQuit();
     Mode getMode();
     void setMode(Mode newMode);
+    // Draw every panel and the mode indicator again on the next frame, e.g.
+    // after something was drawn over them
+    void markScreenDirty();
+    void markModeIndicatorDirty();
+    bool modeIndicatorIsDirty();
+    void modeIndicatorDrawn();
     void swapPanelDown();
     void swapPanelUp();
     bool userHasUnsavedChanges();
     void changesMade();
+    void changesRestored();
+    void resetHistory();
+    EditHistory * getHistory();
+    SearchIndex * getSearchIndex();
+    SearchMatches * getSearchMatches();
+    // Highlight the items found for query in every panel
+    void showSearchResults(std::string query, std::vector<uint64_t> & ids);
+    void runSearch(std::string query);
+    void clearSearch();
+    // Bring the index up to date and search again for what is shown
+    void refreshSearch();
+    // The read-only panel of overdue and upcoming items across all sections.
+    // It is filled once the DueIndex has been built.
+    void showUpcoming(Box bounds);
+    SectionPanel * getUpcomingPanel();
+    // Bring the due-date index up to date and fill the Upcoming panel again
+    void refreshUpcoming();
+    // The same, but only once the first build is done or the day has changed
+    void refreshUpcomingIfStale();
+    // Fit the panels, the Upcoming one included, to the screen again
+    void relayoutPanels();
     void changesSaved();
+    void changesSavedAt(uint64_t generation);
+    void changesSubmitted();
+    void saveFailed();
+    bool hasUnsubmittedChanges();
+    void setSavedFingerprint(uint64_t fingerprint);
+    uint64_t getSavedFingerprint();
+    // What the list on disk holds, for telling which sections have unsaved
+    // edits when someone else changes it. Saving and loading record the
+    // sections as they are.
+    void rememberSavedSections();
+    void setSavedSections(std::vector<SavedSection> sections);
+    std::vector<SavedSection> & getSavedSections();
+    std::chrono::steady_clock::time_point getLastChangeTime();
+    uint64_t getChangeGeneration();
+    ListWriter * getListWriter();
+    ListJournal * getJournal();
     std::string getListPath();
+    void watchList(std::string absListPath);
+    bool listChangedOnDisk();
+    // The descriptor that becomes readable when the list may have changed on
+    // disk, or -1
+    int getListWatchFd();
+    EventLoop * getEventLoop();
+    // Whether a save or the due-date index is being worked on by another
+    // thread, and has to be looked in on until it lands
+    bool hasBackgroundWork();
 
 };
@@ -2,6 +2,7 @@
 
 #include <ncurses.h>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <map>
 #include <vector>
@@ -78,6 +79,7 @@ struct Box {
 /////////////////////////////// DRAWING UTILS ////////////////////////////////
 
 // Drawing functions can take an optional WINDOW *, otherwise use stdscr
+// Strings, lines, fills and clears go to curses a whole span at a time
 
 // Get attributes by a friendly, human-readable name
 int getAttribute(std::string name);
@@ -90,10 +92,14 @@ int combineAttributes(int num, ...);
 void drawCharAtPoint(char ch, Point p, WINDOW * win = NULL);
 
 // Draw string at a given point
-void drawStringAtPoint(std::string text, Point p, WINDOW * win = NULL);
+void drawStringAtPoint(std::string_view text, Point p, WINDOW * win = NULL);
 
 // Draw a string centered on a given point
-void drawCenteredStringAtPoint(std::string text, Point p, WINDOW * win = NULL);
+void drawCenteredStringAtPoint(std::string_view text, Point p, WINDOW * win = NULL);
+
+// Draw a string at a given point, then pad it with spaces to width columns,
+// so a whole row is painted with every cell written once
+void drawPaddedStringAtPoint(std::string_view text, int width, Point p, WINDOW * win = NULL);
 
 // Set attributes for the given WINDOW (or default to stdscr)
 void setAttributes(int attr, WINDOW * win = NULL);
@@ -128,6 +134,10 @@ void fillBoxWithChar(Box b, char ch, WINDOW * win = NULL);
 // I do this instead of using clear() to avoid latency issues
 void clearBox(Box b, WINDOW * win = NULL);
 
+// Clear the whole window with werase(), which only blanks it in memory like
+// clearBox() does, without clear()'s full repaint of the terminal
+void clearWindow(WINDOW * win = NULL);
+
 /////////////////////////////// BASE CLASSES /////////////////////////////////
 
 /*
@@ -175,6 +185,10 @@ public:
  * the terminal screen as a whole and it will handle sizing and resizing for
  * you! When users subclass this base class, they have the option of making
  * their own drawPanel() function, but the default is provided out of the box.
+ *
+ * Panels don't write to the terminal themselves. refreshWindow() copies the
+ * window into curses' picture of the next screen, and the one doupdate() per
+ * frame sends only the cells that differ from what is already shown.
  */
 class Panel {
 
@@ -414,8 +428,8 @@ private:
             int columns = (int) (frac * fullWidth);
 
             // Truncate columns if they would go offscreen
-            if(lastX + 1 + columns >= fullWidth) {
-                columns = fullWidth - (lastX + 1);
+            if(lastX + 1 + columns >= startX + fullWidth) {
+                columns = startX + fullWidth - (lastX + 1);
             }
 
             // Turn those rows and columns into Box dimensions
@@ -467,8 +481,8 @@ private:
             int columns = fullWidth;
 
             // Truncate rows if they would go offscreen
-            if(lastY + 1 + rows >= fullHeight) {
-                rows = fullHeight - (lastY + 1);
+            if(lastY + 1 + rows >= startY + fullHeight) {
+                rows = startY + fullHeight - (lastY + 1);
             }
 
             // Turn those rows and columns into Box dimensions
@@ -1,11 +1,18 @@
 #include "Command.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
 Command::Command(State * state) : state(state) {}
 
 void Command::clearBehindDialogForm() {
     Point ul(0, LINES - 1); Point lr(COLS - 1, LINES - 1);
     Box box(ul, lr);
     clearBox(box);
+
+    // The mode indicator shares the line with the dialog
+    state->markModeIndicatorDirty();
 }
 
 bool Command::checkForNumItems(int minimum) {
@@ -14,6 +21,64 @@ bool Command::checkForNumItems(int minimum) {
     return numItems > minimum;
 }
 
+void Command::restoreSnapshot(EditHistory::Snapshot snapshot) {
+    // Panels whose section the step didn't touch are kept as they are
+    std::vector<SectionPanel *> oldPanels = state->getPanels();
+    std::vector<SectionPanel *> panels = PanelConstructor::reconcilePanelsWithSections(oldPanels, snapshot.sections,
+                                                                                      state->getDocument());
+    state->replacePanels(panels);
+    state->setCurrentPanel(std::min(snapshot.currentPanel, (int)panels.size() - 1));
+
+    state->changesRestored();
+}
+
+void Command::focusSearchMatch(bool forward, bool includeCurrent) {
+    SearchMatches * matches = state->getSearchMatches();
+    if(matches->ids.empty()) { return; }
+
+    // The document is in panel order, so a match's place is its section's
+    // index and its position there
+    Document * document = state->getDocument();
+    std::unordered_map<Section *, int> panelIndices;
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        panelIndices[document->getSection(i)] = i;
+    }
+
+    std::vector<std::pair<int, int>> places;
+    for(uint64_t id : matches->ids) {
+        Section * section;
+        int position;
+        if(document->locateItem(id, section, position)) {
+            places.emplace_back(panelIndices[section], position);
+        }
+    }
+    if(places.empty()) { return; }
+    std::sort(places.begin(), places.end());
+
+    std::pair<int, int> current(state->getCurrentPanelIndex(), state->getCurrentPanel()->getCurrentItemIndex());
+    std::pair<int, int> target;
+    if(forward) {
+        auto next = includeCurrent ? std::lower_bound(places.begin(), places.end(), current)
+                                   : std::upper_bound(places.begin(), places.end(), current);
+        target = next == places.end() ? places.front() : *next;
+    } else {
+        auto next = std::lower_bound(places.begin(), places.end(), current);
+        target = next == places.begin() ? places.back() : *(next - 1);
+    }
+
+    state->setCurrentPanel(target.first);
+    state->getCurrentPanel()->highlightItemAt(target.second);
+}
+
+void Command::stopKeepingSorted() {
+    SectionPanel * panel = state->getCurrentPanel();
+    if(panel->getSectionRef().sortOrder == UNSORTED) { return; }
+
+    panel->sortItems(UNSORTED, false);
+    state->getJournal()->recordSort(state->getCurrentPanelIndex(), UNSORTED, false);
+}
+
 NOPCommand::NOPCommand(State * state) : Command(state) {}
 
 void NOPCommand::execute() {
@@ -23,15 +88,16 @@ void NOPCommand::execute() {
 ResizeWindowCommand::ResizeWindowCommand(State * state) : Command(state) {}
 
 void ResizeWindowCommand::execute() {
-    std::vector<Section> sections = state->getSections();
-    std::vector<SectionPanel *> newPanels = PanelConstructor::constructPanelsFromSections(sections);
-    state->replacePanels(newPanels);
+    state->relayoutPanels();
+    state->markScreenDirty();
 }
 
 QuitApplicationCommand::QuitApplicationCommand(State * state) : Command(state) {}
 
 void QuitApplicationCommand::execute() {
-    if(state->userHasUnsavedChanges()) {
+    // A save already handed to the writer is finished before we exit, so
+    // only ask about edits no save (or autosave) has picked up yet
+    if(state->hasUnsubmittedChanges()) {
         setupDialog();
         bool saveFile = getUserChoice();
         if(saveFile) {
@@ -61,8 +127,43 @@ void QuitApplicationCommand::teardownDialog() {
 SaveFileCommand::SaveFileCommand(State * state) : Command(state) {}
 
 void SaveFileCommand::execute() {
-    ListSerializer::serializeListToFile(state);
-    state->changesSaved();
+    // Only the in-memory copy is made here, the writer thread does the disk
+    // work and the engine marks the changes saved once it has landed
+    ListJournal * journal = state->getJournal();
+    state->changesSubmitted();
+
+    // Nothing to write if the list would come out as it was last saved, e.g.
+    // after an edit that was submitted unchanged
+    uint64_t fingerprint = ListSerializer::fingerprintList(state);
+    if(fingerprint == state->getSavedFingerprint()) {
+        journal->discardPendingRecords();
+        state->changesSaved();
+        return;
+    }
+    state->setSavedFingerprint(fingerprint);
+
+    if(journal->isEnabled() && !journal->needsCompaction()) {
+        appendToJournal(journal);
+        return;
+    }
+
+    ListLayout layout = ListSerializer::layOutList(state);
+    std::string listPath = ListSerializer::getAbsoluteListPath(state);
+    std::string journalPath = "";
+    if(journal->isEnabled()) {
+        // The new journal is tied to the checksum of the whole new list
+        journal->compactedInto(layout.flatten());
+        journalPath = journal->getPath();
+    }
+
+    state->getListWriter()->save(listPath, std::move(layout), state->getChangeGeneration(), journalPath);
+}
+
+void SaveFileCommand::appendToJournal(ListJournal * journal) {
+    // Only the edits made since the last save go to disk
+    bool truncate;
+    std::string records = journal->takePendingRecords(truncate);
+    state->getListWriter()->append(journal->getPath(), std::move(records), truncate, state->getChangeGeneration());
 }
 
 FocusPanelDownCommand::FocusPanelDownCommand(State * state) : Command(state) {}
@@ -129,6 +230,7 @@ CycleColorCommand::CycleColorCommand(State * state) : Command(state) {}
 void CycleColorCommand::execute() {
     SectionPanel * panel = state->getCurrentPanel();
     panel->incrementColorCode();
+    state->getJournal()->recordColor(state->getCurrentPanelIndex(), panel->getSectionRef().colorCode);
 
     state->changesMade();
 }
@@ -165,7 +267,16 @@ std::string EditItemCommand::getUserInput() {
 
 void EditItemCommand::changeItemName(std::string input) {
     SectionPanel * panel = state->getCurrentPanel();
+    int sectionIndex = state->getCurrentPanelIndex();
+    int itemIndex = panel->getCurrentItemIndex();
     panel->setCurrentItem(input);
+
+    // An empty name deletes the item
+    if(input == "") {
+        state->getJournal()->recordDeleteItem(sectionIndex, itemIndex);
+    } else {
+        state->getJournal()->recordEditItem(sectionIndex, itemIndex, input);
+    }
 }
 
 void EditItemCommand::teardownEditBuffer() {
@@ -203,6 +314,7 @@ std::string EditSectionCommand::getUserInput() {
 void EditSectionCommand::changeSectionName(std::string input) {
     SectionPanel * panel = state->getCurrentPanel();
     panel->setSectionTitle(input);
+    state->getJournal()->recordTitle(state->getCurrentPanelIndex(), input);
 }
 
 void EditSectionCommand::teardownEditBuffer() {
@@ -232,7 +344,11 @@ std::string NewItemCommand::getUserInput() {
 
 void NewItemCommand::addItemToSection(std::string newItem) {
     SectionPanel * panel = state->getCurrentPanel();
-    panel->addItem(newItem);
+    uint64_t id = panel->addItem(newItem);
+
+    if(newItem != "") {
+        state->getJournal()->recordAddItem(state->getCurrentPanelIndex(), newItem, id);
+    }
 }
 
 void NewItemCommand::teardownEditBuffer() {
@@ -264,11 +380,10 @@ void NewSectionCommand::createNewSectionWithName(std::string name) {
     std::string colorStr = Config::getInstance().getValueFromKey("DefaultSectionColor");
     int colorCode = getCodeFromColorStr(colorStr);
 
-    Section newSection(name, colorCode);
-    std::vector<Section> sections = state->getSections();
-    sections.push_back(newSection);
-    std::vector<SectionPanel *> newPanels = PanelConstructor::constructPanelsFromSections(sections);
+    Section * newSection = state->getDocument()->addSection(Section(name, colorCode));
+    std::vector<SectionPanel *> newPanels = PanelConstructor::addPanelForSection(state->getPanels(), newSection);
     state->replacePanels(newPanels);
+    state->getJournal()->recordNewSection(colorCode, name);
 }
 
 int NewSectionCommand::getCodeFromColorStr(std::string colorStr) {
@@ -320,6 +435,7 @@ bool DeleteItemCommand::getUserChoice() {
 
 void DeleteItemCommand::deleteCurrentItem() {
     SectionPanel * panel = state->getCurrentPanel();
+    state->getJournal()->recordDeleteItem(state->getCurrentPanelIndex(), panel->getCurrentItemIndex());
     panel->deleteCurrentItem();
 }
 
@@ -356,6 +472,7 @@ bool DeleteSectionCommand::getUserChoice() {
 }
 
 void DeleteSectionCommand::deleteCurrentSection() {
+    state->getJournal()->recordDeleteSection(state->getCurrentPanelIndex());
     state->removeCurrentPanel();
 
     std::vector<SectionPanel *> panels = state->getPanels();
@@ -373,11 +490,10 @@ void DeleteSectionCommand::addDefaultSection() {
     std::string colorStr = Config::getInstance().getValueFromKey("DefaultSectionColor");
     int colorCode = getCodeFromColorStr(colorStr);
 
-    Section newSection("TODO", colorCode);
-    std::vector<Section> sections = state->getSections();
-    sections.push_back(newSection);
-    std::vector<SectionPanel *> newPanels = PanelConstructor::constructPanelsFromSections(sections);
+    Section * newSection = state->getDocument()->addSection(Section("TODO", colorCode));
+    std::vector<SectionPanel *> newPanels = PanelConstructor::addPanelForSection(state->getPanels(), newSection);
     state->replacePanels(newPanels);
+    state->getJournal()->recordNewSection(colorCode, "TODO");
 }
 
 int DeleteSectionCommand::getCodeFromColorStr(std::string colorStr) {
@@ -422,7 +538,12 @@ void MoveItemDownCommand::execute() {
     if(!enoughItems) { return; }
 
     SectionPanel * panel = state->getCurrentPanel();
+    int itemIndex = panel->getCurrentItemIndex();
     panel->swapItemDown();
+    if(panel->getCurrentItemIndex() != itemIndex) {
+        state->getJournal()->recordSwapItems(state->getCurrentPanelIndex(), itemIndex, itemIndex + 1);
+        stopKeepingSorted();
+    }
 
     state->changesMade();
 }
@@ -434,7 +555,12 @@ void MoveItemUpCommand::execute() {
     if(!enoughItems) { return; }
 
     SectionPanel * panel = state->getCurrentPanel();
+    int itemIndex = panel->getCurrentItemIndex();
     panel->swapItemUp();
+    if(panel->getCurrentItemIndex() != itemIndex) {
+        state->getJournal()->recordSwapItems(state->getCurrentPanelIndex(), itemIndex - 1, itemIndex);
+        stopKeepingSorted();
+    }
 
     state->changesMade();
 }
@@ -445,7 +571,11 @@ void MoveSectionDownCommand::execute() {
     int numPanels = state->getNumPanels();
     if(numPanels <= 1) { return; }
 
+    int sectionIndex = state->getCurrentPanelIndex();
     state->swapPanelDown();
+    if(state->getCurrentPanelIndex() != sectionIndex) {
+        state->getJournal()->recordSwapSections(sectionIndex, sectionIndex + 1);
+    }
 
     Command * resize = new ResizeWindowCommand(state);
     resize->execute();
@@ -460,7 +590,11 @@ void MoveSectionUpCommand::execute() {
     int numPanels = state->getNumPanels();
     if(numPanels <= 1) { return; }
 
+    int sectionIndex = state->getCurrentPanelIndex();
     state->swapPanelUp();
+    if(state->getCurrentPanelIndex() != sectionIndex) {
+        state->getJournal()->recordSwapSections(sectionIndex - 1, sectionIndex);
+    }
 
     Command * resize = new ResizeWindowCommand(state);
     resize->execute();
@@ -480,6 +614,8 @@ void ChangeItemSectionUpCommand::execute() {
 
     SectionPanel * panel = state->getCurrentPanel();
     std::string item = panel->getCurrentItem();
+    uint64_t id = panel->getCurrentItemId();
+    state->getJournal()->recordDeleteItem(state->getCurrentPanelIndex(), panel->getCurrentItemIndex());
     panel->deleteCurrentItem();
 
     Command * focusUp = new FocusPanelUpCommand(state);
@@ -487,7 +623,8 @@ void ChangeItemSectionUpCommand::execute() {
     delete focusUp;
 
     panel = state->getCurrentPanel();
-    panel->addItem(item);
+    panel->addItem(item, id);
+    state->getJournal()->recordAddItem(state->getCurrentPanelIndex(), item, id);
 
     state->changesMade();
 }
@@ -503,6 +640,8 @@ void ChangeItemSectionDownCommand::execute() {
 
     SectionPanel * panel = state->getCurrentPanel();
     std::string item = panel->getCurrentItem();
+    uint64_t id = panel->getCurrentItemId();
+    state->getJournal()->recordDeleteItem(state->getCurrentPanelIndex(), panel->getCurrentItemIndex());
     panel->deleteCurrentItem();
 
     Command * focusDown = new FocusPanelDownCommand(state);
@@ -510,7 +649,207 @@ void ChangeItemSectionDownCommand::execute() {
     delete focusDown;
 
     panel = state->getCurrentPanel();
-    panel->addItem(item);
+    panel->addItem(item, id);
+    state->getJournal()->recordAddItem(state->getCurrentPanelIndex(), item, id);
+
+    state->changesMade();
+}
+
+UndoCommand::UndoCommand(State * state) : Command(state) {}
+
+void UndoCommand::execute() {
+    EditHistory * history = state->getHistory();
+    if(!history->canUndo()) { return; }
+
+    restoreSnapshot(history->undo());
+}
+
+RedoCommand::RedoCommand(State * state) : Command(state) {}
+
+void RedoCommand::execute() {
+    EditHistory * history = state->getHistory();
+    if(!history->canRedo()) { return; }
+
+    restoreSnapshot(history->redo());
+}
+
+SearchCommand::SearchCommand(State * state) : Command(state) {}
+
+void SearchCommand::execute() {
+    setupEditBuffer();
+    std::string input = getUserInput();
+    teardownEditBuffer();
+
+    if(input == "") {
+        state->clearSearch();
+        return;
+    }
+
+    // A short query was only shown once submitted, and the form searched for
+    // the untrimmed input
+    if(SearchIndex::lowercase(input) != state->getSearchMatches()->query) {
+        state->runSearch(input);
+    }
+    focusSearchMatch(true, true);
+}
+
+void SearchCommand::setupEditBuffer() {
+    form = new SearchForm(state);
+}
+
+std::string SearchCommand::getUserInput() {
+    std::string userInput = form->edit();
+    return userInput;
+}
+
+void SearchCommand::teardownEditBuffer() {
+    clearBehindDialogForm();
+    delete form;
+}
 
+FindItemCommand::FindItemCommand(State * state) : Command(state) {}
+
+void FindItemCommand::execute() {
+    setupEditBuffer();
+    getUserInput();
+
+    int panelIndex, itemIndex;
+    bool chosen = form->getChoice(panelIndex, itemIndex);
+    teardownEditBuffer();
+
+    if(chosen) {
+        state->setCurrentPanel(panelIndex);
+        state->getCurrentPanel()->highlightItemAt(itemIndex);
+    }
+}
+
+void FindItemCommand::setupEditBuffer() {
+    form = new FinderForm(state);
+}
+
+void FindItemCommand::getUserInput() {
+    form->edit();
+}
+
+void FindItemCommand::teardownEditBuffer() {
+    clearBehindDialogForm();
+    delete form;
+
+    // The list of matches was drawn over the panels
+    state->markScreenDirty();
+}
+
+FilterItemsCommand::FilterItemsCommand(State * state) : Command(state) {}
+
+void FilterItemsCommand::execute() {
+    setupEditBuffer();
+    std::string input = getUserInput();
+    teardownEditBuffer();
+
+    // Only what the panel shows changes, so there is nothing to save
+    state->getCurrentPanel()->setFilter(input);
+}
+
+void FilterItemsCommand::setupEditBuffer() {
+    form = new DialogForm("Filter (text, /regex/, #tag !N @today @week @overdue @due):", state);
+    form->injectString(state->getCurrentPanel()->getFilter());
+}
+
+std::string FilterItemsCommand::getUserInput() {
+    std::string userInput = form->edit();
+    return userInput;
+}
+
+void FilterItemsCommand::teardownEditBuffer() {
+    clearBehindDialogForm();
+    delete form;
+}
+
+SortCommand::SortCommand(State * state) : Command(state) {}
+
+bool SortCommand::askForOrder(SortOrder & order, bool & keep) {
+    setupDialog();
+    char choice = getUserChoice();
+    teardownDialog();
+
+    // Capitals keep the section sorted from now on, x stops keeping it so
+    switch(tolower(choice)) {
+        case 'a':
+            order = ALPHABETICAL;
+            break;
+        case 'n':
+            order = NATURAL;
+            break;
+        case 'd':
+            order = BY_DUE_DATE;
+            break;
+        case 'p':
+            order = BY_PRIORITY;
+            break;
+        case 'x':
+            order = UNSORTED;
+            break;
+        default:
+            return false;
+    }
+    keep = order != UNSORTED && isupper(choice);
+
+    return true;
+}
+
+void SortCommand::setupDialog() {
+    dialog = new DialogForm("Sort by (a)lpha (n)atural (d)ue (p)riority, capital keeps sorted, (x) stops:", state);
+}
+
+char SortCommand::getUserChoice() {
+    char userChoice = dialog->choose("anpdxANPDX");
+    return userChoice;
+}
+
+void SortCommand::teardownDialog() {
+    clearBehindDialogForm();
+    delete dialog;
+}
+
+void SortCommand::sortPanel(int panelIndex, SortOrder order, bool keep) {
+    SectionPanel * panel = state->getPanels()[panelIndex];
+    panel->sortItems(order, keep);
+    state->getJournal()->recordSort(panelIndex, order, keep);
+}
+
+SortSectionCommand::SortSectionCommand(State * state) : SortCommand(state) {}
+
+void SortSectionCommand::execute() {
+    SortOrder order;
+    bool keep;
+    if(!askForOrder(order, keep)) { return; }
+
+    sortPanel(state->getCurrentPanelIndex(), order, keep);
     state->changesMade();
 }
+
+SortListCommand::SortListCommand(State * state) : SortCommand(state) {}
+
+void SortListCommand::execute() {
+    SortOrder order;
+    bool keep;
+    if(!askForOrder(order, keep)) { return; }
+
+    int numPanels = state->getNumPanels();
+    for(int i = 0; i < numPanels; i++) {
+        sortPanel(i, order, keep);
+    }
+    state->changesMade();
+}
+
+NextMatchCommand::NextMatchCommand(State * state) : Command(state) {}
+
+void NextMatchCommand::execute() {
+    focusSearchMatch(true, false);
+}
+
+PreviousMatchCommand::PreviousMatchCommand(State * state) : Command(state) {}
+
+void PreviousMatchCommand::execute() {
+    focusSearchMatch(false, false);
+}
@@ -3,7 +3,7 @@
 CommandFactory::CommandFactory(State * state) : state(state) {}
 
 Command * CommandFactory::getCommandFromKey(int key) {
-	Command * command;
+	Command * command = NULL;
     if(state->getMode() == Mode::NORMAL) {
         switch(key) {
             case KEY_RESIZE:
@@ -59,6 +59,33 @@ Command * CommandFactory::getCommandFromKey(int key) {
             case 'm':
                 command = new ToggleMoveModeCommand(state);
                 break;
+            case 'u':
+                command = new UndoCommand(state);
+                break;
+            case KEY_CTRL('r'):
+                command = new RedoCommand(state);
+                break;
+            case '/':
+                command = new SearchCommand(state);
+                break;
+            case 'f':
+                command = new FindItemCommand(state);
+                break;
+            case 'F':
+                command = new FilterItemsCommand(state);
+                break;
+            case 'o':
+                command = new SortSectionCommand(state);
+                break;
+            case 'O':
+                command = new SortListCommand(state);
+                break;
+            case ';':
+                command = new NextMatchCommand(state);
+                break;
+            case ',':
+                command = new PreviousMatchCommand(state);
+                break;
             default:
                 command = new NOPCommand(state);
                 break;
@@ -92,9 +119,21 @@ Command * CommandFactory::getCommandFromKey(int key) {
             case '>':
                 command = new ChangeItemSectionDownCommand(state);
                 break;
+            case 'o':
+                command = new SortSectionCommand(state);
+                break;
+            case 'O':
+                command = new SortListCommand(state);
+                break;
             case 'm':
                 command = new ToggleMoveModeCommand(state);
                 break;
+            case 'u':
+                command = new UndoCommand(state);
+                break;
+            case KEY_CTRL('r'):
+                command = new RedoCommand(state);
+                break;
             default:
                 command = new NOPCommand(state);
                 break;
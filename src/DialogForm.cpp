@@ -11,7 +11,7 @@ std::string DialogForm::edit() {
     bool exit = false;
     while(!exit) {
         drawForm();
-        ch = wgetch(win);
+        ch = readKey();
         switch(ch) {
             case KEY_RESIZE: // Our custom form handles resizing
                 resizeForm();
@@ -23,6 +23,7 @@ std::string DialogForm::edit() {
                 break;
             default: // Delegate to form driver
                 handleInput(ch);
+                inputChanged();
                 break;
         }
     }
@@ -41,12 +42,27 @@ void DialogForm::resizeForm() {
     win = newwin(lines, COLS - 1, origin.y, origin.x);
 }
 
+int DialogForm::readKey(int timeoutMs) {
+    return state->getEventLoop()->waitForKey(win, timeoutMs);
+}
+
 void DialogForm::resizePanels() {
-    std::vector<Section> sections = state->getSections();
-    std::vector<SectionPanel *> newPanels = PanelConstructor::constructPanelsFromSections(sections);
-    state->replacePanels(newPanels);
+    state->relayoutPanels();
+    state->markScreenDirty();
+    redrawPanels();
+}
 
-    for(SectionPanel * panel : newPanels) {
+void DialogForm::redrawPanels() {
+    // Only panels the input changed, e.g. by searching, are drawn again.
+    // They reach the screen along with the form, when reading a key refreshes it.
+    SectionPanel * upcoming = state->getUpcomingPanel();
+    if(upcoming != nullptr && upcoming->isDirty()) {
+        upcoming->drawPanel();
+    }
+    for(SectionPanel * panel : state->getPanels()) {
+        if(!panel->isDirty()) {
+            continue;
+        }
         if(state->panelIsFocused(panel)) {
             panel->drawPanelFocused();
         } else {
@@ -61,7 +77,7 @@ bool DialogForm::dialog() {
     bool choice = false;
     while(!exit) {
         drawDialog();
-        ch = wgetch(win);
+        ch = readKey();
         switch(ch) {
             case KEY_RESIZE:
                 resizeForm();
@@ -86,6 +102,22 @@ bool DialogForm::dialog() {
     return choice;
 }
 
+char DialogForm::choose(std::string choices) {
+    int ch;
+    while(true) {
+        drawDialog();
+        ch = readKey();
+        if(ch == KEY_RESIZE) {
+            resizeForm();
+            resizePanels();
+        } else if(ch == KEY_F(1)) {
+            return 0;
+        } else if(ch > 0 && ch < 256 && choices.find((char)ch) != std::string::npos) {
+            return (char)ch;
+        }
+    }
+}
+
 void DialogForm::drawDialog() {
     drawStringAtPoint(prompt, origin, win);
 }
@@ -0,0 +1,115 @@
+#include "Document.hpp"
+
+Document::Document() {}
+
+Section * Document::addSection(Section section) {
+    sections.push_back(std::make_unique<Section>(std::move(section)));
+    sections.back()->attachIndex(&itemIndex);
+
+    return sections.back().get();
+}
+
+void Document::removeSection(Section * handle) {
+    int index = indexOf(handle);
+    if(index < 0) { return; }
+
+    sections[index]->detachIndex();
+    sections.erase(sections.begin() + index);
+}
+
+void Document::swapSections(int a, int b) {
+    std::swap(sections[a], sections[b]);
+}
+
+void Document::arrange(std::vector<Section *> order) {
+    // Take ownership back in the new order, whatever is left over goes
+    std::vector<std::unique_ptr<Section>> arranged;
+    arranged.reserve(order.size());
+    for(Section * handle : order) {
+        int index = indexOf(handle);
+        if(index >= 0) {
+            arranged.push_back(std::move(sections[index]));
+        }
+    }
+    for(std::unique_ptr<Section> & dropped : sections) {
+        if(dropped != nullptr) {
+            dropped->detachIndex();
+        }
+    }
+
+    sections = std::move(arranged);
+}
+
+int Document::getNumSections() {
+    return (int)sections.size();
+}
+
+Section * Document::getSection(int index) {
+    return sections[index].get();
+}
+
+std::vector<Section> Document::copySections() {
+    std::vector<Section> copies;
+    copies.reserve(sections.size());
+    for(std::unique_ptr<Section> & section : sections) {
+        copies.push_back(*section);
+    }
+
+    return copies;
+}
+
+bool Document::locateItem(uint64_t id, Section *& section, int & position) {
+    if(!itemIndex.isActive()) {
+        itemIndex.activate();
+        for(std::unique_ptr<Section> & held : sections) {
+            held->registerItems();
+        }
+    }
+
+    // Items of lazily loaded sections are only known once they're indexed
+    ItemLocation location;
+    if(!itemIndex.find(id, location)) {
+        bool indexedMore = false;
+        for(std::unique_ptr<Section> & held : sections) {
+            if(held->isLazy()) {
+                held->getNumItems();
+                indexedMore = true;
+            }
+        }
+        if(!indexedMore || !itemIndex.find(id, location)) {
+            return false;
+        }
+    }
+
+    // Items inserted or erased ahead of it may have moved it a little. If
+    // it has moved further, every position in its section is brought up to
+    // date at once, so later lookups there are exact again.
+    int found = location.section->findItemById(id, location.position, ITEM_LOCATE_RADIUS);
+    if(found < 0) {
+        location.section->registerItems();
+        itemIndex.find(id, location);
+        found = location.section->findItemById(id, location.position, 0);
+    }
+    if(found < 0) {
+        itemIndex.remove(id);
+        return false;
+    }
+    if(found != location.position) {
+        itemIndex.add(id, location.section, found);
+    }
+
+    section = location.section;
+    position = found;
+    return true;
+}
+
+int Document::indexOf(Section * handle) {
+    int numSections = (int)sections.size();
+    for(int i = 0; i < numSections; i++) {
+        if(sections[i].get() == handle) {
+            return i;
+        }
+    }
+
+    return -1;
+}
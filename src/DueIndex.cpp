@@ -0,0 +1,162 @@
+#include "DueIndex.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <tuple>
+
+#include "Config.hpp"
+#include "ItemTokens.hpp"
+
+DueIndex::DueIndex() {}
+
+DueIndex::~DueIndex() {
+    stopBuild();
+}
+
+int DueIndex::upcomingDays() {
+    std::string daysStr = Config::getInstance().getValueFromKey("UpcomingDays");
+    if(daysStr == "") {
+        return DEFAULT_UPCOMING_DAYS;
+    }
+
+    int days = 0;
+    auto result = std::from_chars(daysStr.data(), daysStr.data() + daysStr.size(), days);
+    if(result.ec != std::errc() || result.ptr != daysStr.data() + daysStr.size() || days < 0) {
+        return DEFAULT_UPCOMING_DAYS;
+    }
+
+    return days;
+}
+
+void DueIndex::build(Document * document, int today) {
+    stopBuild();
+    startBuild(document, today);
+}
+
+void DueIndex::startBuild(Document * document, int today) {
+    tracker.prepareBuild(document);
+    built = std::make_unique<Tables>();
+    built->today = today;
+    tracker.startBuild([this]() { runBuild(); });
+}
+
+void DueIndex::runBuild() {
+    // Dated items are collected first and put in order all at once, which
+    // is much cheaper than adding them to the tables one by one
+    Tables & into = *built;
+    std::vector<std::tuple<int, uint64_t, uint64_t>> order;
+    tracker.visitDescribedBuildItems([&](Section * section, uint64_t id, std::string_view text,
+                                         const ItemMetadata & metadata, int index) {
+        int dueDate = metadata.getDueDate(index);
+        if(dueDate == 0) { return; }
+
+        int resolved = ItemTokens::resolveDate(dueDate, into.today);
+        uint64_t sequence = into.nextSequence++;
+        order.emplace_back(resolved, sequence, id);
+        into.dues.emplace(id, Due{dueDate, resolved, sequence, into.stamp, text, section});
+    });
+
+    std::sort(order.begin(), order.end());
+    for(auto & [resolved, sequence, id] : order) {
+        into.byDate.emplace_hint(into.byDate.end(), std::make_pair(resolved, sequence), id);
+    }
+}
+
+void DueIndex::finishBuild(Document * document, int today) {
+    tracker.finishBuild(document);
+    tables = std::move(built);
+    sync(document, today);
+}
+
+void DueIndex::stopBuild() {
+    tracker.stopBuild();
+    built.reset();
+}
+
+bool DueIndex::isBuilding() {
+    return tracker.isBuilding();
+}
+
+bool DueIndex::hasFinishedBuild() {
+    return tracker.hasFinishedBuild();
+}
+
+void DueIndex::addItem(Tables & into, uint64_t id, std::string_view text, int dueDate, Section * section) {
+    auto found = into.dues.find(id);
+    if(found != into.dues.end()) {
+        Due & due = found->second;
+        due.stamp = into.stamp;
+        due.text = text;
+        due.section = section;
+        if(due.dueDate == dueDate) { return; }
+
+        // It keeps its place among items due the same day
+        uint64_t sequence = due.sequence;
+        removeItem(into, id);
+        if(dueDate == 0) { return; }
+
+        int resolved = ItemTokens::resolveDate(dueDate, into.today);
+        into.dues.emplace(id, Due{dueDate, resolved, sequence, into.stamp, text, section});
+        into.byDate[{resolved, sequence}] = id;
+        return;
+    }
+    if(dueDate == 0) { return; }
+
+    int resolved = ItemTokens::resolveDate(dueDate, into.today);
+    uint64_t sequence = into.nextSequence++;
+    into.dues.emplace(id, Due{dueDate, resolved, sequence, into.stamp, text, section});
+    into.byDate[{resolved, sequence}] = id;
+}
+
+void DueIndex::removeItem(Tables & from, uint64_t id) {
+    auto found = from.dues.find(id);
+    if(found == from.dues.end()) { return; }
+
+    from.byDate.erase({found->second.resolved, found->second.sequence});
+    from.dues.erase(found);
+}
+
+void DueIndex::resolveDates(Tables & in, int today) {
+    in.today = today;
+    in.byDate.clear();
+    for(auto & [id, due] : in.dues) {
+        due.resolved = ItemTokens::resolveDate(due.dueDate, today);
+        in.byDate[{due.resolved, due.sequence}] = id;
+    }
+}
+
+void DueIndex::sync(Document * document, int today) {
+    if(hasFinishedBuild()) {
+        finishBuild(document, today);
+        return;
+    }
+    if(isBuilding() || tables == nullptr) { return; }
+
+    Tables & t = *tables;
+    if(t.today != today) {
+        resolveDates(t, today);
+    }
+    t.stamp++;
+    tracker.catchUp(document, [&](Section * section, uint64_t id, std::string_view text, int index) {
+        addItem(t, id, text, section->getDueDate(index), section);
+    }, [&](uint64_t id) {
+        auto due = t.dues.find(id);
+        if(due != t.dues.end() && due->second.stamp != t.stamp) {
+            removeItem(t, id);
+        }
+    });
+}
+
+std::vector<DueIndex::DueItem> DueIndex::findDueBy(int lastDate, size_t limit) {
+    std::vector<DueItem> found;
+    if(tables == nullptr) { return found; }
+
+    for(auto & [key, id] : tables->byDate) {
+        if(key.first > lastDate || found.size() >= limit) { break; }
+
+        Due & due = tables->dues.at(id);
+        found.push_back(DueItem{id, due.resolved, due.text, due.section});
+    }
+
+    return found;
+}
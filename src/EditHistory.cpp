@@ -0,0 +1,97 @@
+#include "EditHistory.hpp"
+
+#include <charconv>
+
+#include "Config.hpp"
+
+EditHistory::EditHistory() : current{std::vector<Section>(), 0} {
+    depth = undoDepth();
+}
+
+size_t EditHistory::undoDepth() {
+    std::string depthStr = Config::getInstance().getValueFromKey("UndoDepth");
+    if(depthStr == "") {
+        return DEFAULT_UNDO_DEPTH;
+    }
+
+    size_t depth = 0;
+    auto result = std::from_chars(depthStr.data(), depthStr.data() + depthStr.size(), depth);
+    if(result.ec != std::errc() || result.ptr != depthStr.data() + depthStr.size()) {
+        return DEFAULT_UNDO_DEPTH;
+    }
+
+    return depth;
+}
+
+bool EditHistory::isEnabled() {
+    return depth > 0;
+}
+
+void EditHistory::reset(Snapshot base) {
+    undoStack.clear();
+    redoStack.clear();
+    current = base;
+}
+
+void EditHistory::record(Snapshot next) {
+    // Edits that left the list as it was (e.g. cancelled ones) aren't steps
+    if(sameAsCurrent(next)) {
+        current = next;
+        return;
+    }
+
+    undoStack.push_back(current);
+    redoStack.clear();
+    current = next;
+    trimToDepth();
+}
+
+bool EditHistory::canUndo() {
+    return !undoStack.empty();
+}
+
+bool EditHistory::canRedo() {
+    return !redoStack.empty();
+}
+
+EditHistory::Snapshot EditHistory::undo() {
+    Snapshot previous = undoStack.back();
+    undoStack.pop_back();
+
+    previous.currentPanel = current.currentPanel;
+    redoStack.push_back(current);
+    current = previous;
+
+    return current;
+}
+
+EditHistory::Snapshot EditHistory::redo() {
+    Snapshot next = redoStack.back();
+    redoStack.pop_back();
+
+    undoStack.push_back(current);
+    current = next;
+
+    return current;
+}
+
+bool EditHistory::sameAsCurrent(Snapshot & snapshot) {
+    int numSections = (int)snapshot.sections.size();
+    if(numSections != (int)current.sections.size()) {
+        return false;
+    }
+
+    for(int i = 0; i < numSections; i++) {
+        if(!snapshot.sections[i].sharesContentsWith(current.sections[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void EditHistory::trimToDepth() {
+    while(undoStack.size() > depth) {
+        undoStack.pop_front();
+    }
+}
@@ -0,0 +1,112 @@
+#include "EventLoop.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+EventLoop::EventLoop() : signalFd(-1), timerFd(-1) {
+    setupSignalFd();
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+EventLoop::~EventLoop() {
+    if(timerFd >= 0) {
+        close(timerFd);
+    }
+    if(signalFd >= 0) {
+        close(signalFd);
+        pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    }
+}
+
+void EventLoop::setupSignalFd() {
+    sigset_t resize;
+    sigemptyset(&resize);
+    sigaddset(&resize, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &resize, &previousMask);
+
+    // Without a signalfd curses keeps handling resizes itself, and they
+    // show up once something else wakes us
+    signalFd = signalfd(-1, &resize, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(signalFd < 0) {
+        pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    }
+}
+
+void EventLoop::waitForEvents(int watchedFd, std::chrono::steady_clock::time_point deadline) {
+    armTimer(deadline);
+
+    // poll() skips descriptors that are -1
+    struct pollfd fds[4] = {
+        {STDIN_FILENO, POLLIN, 0},
+        {signalFd, POLLIN, 0},
+        {timerFd, POLLIN, 0},
+        {watchedFd, POLLIN, 0},
+    };
+    while(poll(fds, 4, -1) < 0) {
+        if(errno != EINTR) { return; }
+    }
+
+    if(fds[1].revents & POLLIN) {
+        readResize();
+    }
+    if(fds[2].revents & POLLIN) {
+        readTimer();
+    }
+}
+
+void EventLoop::armTimer(std::chrono::steady_clock::time_point deadline) {
+    if(timerFd < 0) { return; }
+
+    // An all-zero setting disarms the timer. steady_clock is CLOCK_MONOTONIC,
+    // so the deadline can be armed as it is.
+    struct itimerspec setting = {};
+    if(deadline != std::chrono::steady_clock::time_point::max()) {
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        nanoseconds = std::max(nanoseconds, (decltype(nanoseconds))1);
+        setting.it_value.tv_sec = nanoseconds / 1000000000;
+        setting.it_value.tv_nsec = nanoseconds % 1000000000;
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &setting, nullptr);
+}
+
+void EventLoop::readResize() {
+    // Any number of resizes come down to the size the terminal has now
+    struct signalfd_siginfo info;
+    while(read(signalFd, &info, sizeof(info)) == sizeof(info)) {}
+
+    struct winsize size;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        resizeterm(size.ws_row, size.ws_col);
+    }
+}
+
+void EventLoop::readTimer() {
+    uint64_t expirations;
+    while(read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {}
+}
+
+int EventLoop::waitForKey(WINDOW * win, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if(timeoutMs >= 0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    }
+
+    // Curses may already hold keys read along with an earlier one, which
+    // poll() can't see, so it is always asked first
+    nodelay(win, TRUE);
+    while(true) {
+        int key = wgetch(win);
+        if(key != ERR || std::chrono::steady_clock::now() >= deadline) {
+            return key;
+        }
+
+        waitForEvents(-1, deadline);
+    }
+}
@@ -1,25 +1,109 @@
 #include "FileProcessor.hpp"
 
-FileProcessor::FileProcessor(std::string inputFileIn) : inputFile(inputFileIn) {
-	infile.open(inputFile, std::ios::in);
-    if(!infile.good()) {
-        const char * message = "File does not exist.";
-        throw InvalidFileException(message);
-    }
-
-	if(!std::getline(infile, line)) {
-		isEOF = true;
+FileProcessor::FileProcessor(std::string inputFileIn) :
+	cursor(0), nextNewline(0), scannedUpTo(0), isEOF(false) {
+	try {
+		file = std::make_shared<MappedFile>(inputFileIn);
+	} catch(InvalidFileException& e) {
+		throw InvalidFileException(e.what());
+	}
+
+	contents = file->getContents();
+	advance();
+}
+
+FileProcessor::FileProcessor(std::shared_ptr<MappedFile> fileIn, std::string_view range) :
+	file(fileIn), contents(range), cursor(0), nextNewline(0), scannedUpTo(0), isEOF(false) {
+	advance();
+}
+
+std::string_view FileProcessor::poll() {
+	std::string_view ret = line;
+	advance();
+
+	return ret;
+}
+
+void FileProcessor::skipToSectionHeader() {
+	// Everything up to the next line starting with '[' would be skipped anyway
+	if(isEOF || (!line.empty() && line[0] == '[')) {
+		return;
+	}
+
+	size_t begin = line.data() - contents.data();
+	size_t header = LineScanner::findSectionHeader(contents, begin);
+	if(header == std::string_view::npos) {
+		cursor = contents.size();
 	} else {
-		isEOF = false;
+		cursor = header + 1;
 	}
+
+	advance();
 }
 
-std::string FileProcessor::poll() {
-	std::string ret = line;
+std::string_view FileProcessor::pollBlock() {
+	// Hand back every line up to the next blank one as one unsplit view
+	if(isEOF) {
+		return std::string_view();
+	}
+	if(line.empty()) {
+		advance();
+		return std::string_view();
+	}
+
+	size_t begin = line.data() - contents.data();
+	size_t end = LineScanner::findBlankLine(contents, begin);
+	if(end == std::string_view::npos) {
+		end = contents.size();
+		if(contents.back() == '\n') {
+			end--;
+		}
+		cursor = contents.size();
+	} else {
+		// Skip past the blank line, just like poll() would have consumed it
+		cursor = end + 2;
+	}
+
+	advance();
+
+	return contents.substr(begin, end - begin);
+}
 
-	if(!std::getline(infile, line)) {
+void FileProcessor::advance() {
+	// Mirror std::getline: a trailing newline does not start an extra line
+	if(cursor >= contents.size()) {
 		isEOF = true;
+		return;
 	}
 
-	return ret;
+	size_t newline = findNextNewline();
+	line = contents.substr(cursor, newline - cursor);
+	cursor = newline + 1;
+}
+
+size_t FileProcessor::findNextNewline() {
+	while(true) {
+		// Drop line ends that a jump (pollBlock and friends) moved past
+		while(nextNewline < newlines.size() && newlines[nextNewline] < cursor) {
+			nextNewline++;
+		}
+		if(nextNewline < newlines.size()) {
+			return newlines[nextNewline++];
+		}
+		if(scannedUpTo >= contents.size()) {
+			return contents.size();
+		}
+
+		// Scan the next window of the file for line ends all at once
+		size_t begin = std::max(cursor, scannedUpTo);
+		size_t end = std::min(begin + NEWLINE_WINDOW_SIZE, contents.size());
+		newlines.clear();
+		nextNewline = 0;
+		LineScanner::findNewlines(contents, begin, end, newlines);
+		scannedUpTo = end;
+	}
+}
+
+std::shared_ptr<MappedFile> FileProcessor::getFile() {
+	return file;
 }
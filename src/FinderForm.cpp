@@ -0,0 +1,160 @@
+#include "FinderForm.hpp"
+
+#include <algorithm>
+
+FinderForm::FinderForm(State * state) :
+    DialogForm("Find:", state), finder(state->getDocument()), list(NULL), selected(0), chosen(false) {
+    placeList();
+}
+
+FinderForm::~FinderForm() {
+    delwin(list);
+}
+
+void FinderForm::placeList() {
+    if(list != NULL) {
+        delwin(list);
+    }
+
+    // Centered over the panels, leaving the input line free
+    listColumns = std::max(COLS * 3 / 4, std::min(COLS, 24));
+    listLines = std::max((LINES - 1) * 3 / 4, std::min(LINES - 1, 5));
+    int x = (COLS - listColumns) / 2;
+    int y = (LINES - 1 - listLines) / 2;
+    list = newwin(listLines, listColumns, y, x);
+}
+
+std::string FinderForm::edit() {
+    // Make cursor visible while typing
+    curs_set(1);
+
+    int ch;
+    bool exit = false;
+    while(!exit) {
+        finder.collect();
+        drawList();
+        drawForm();
+
+        // Only wake up without a key while results are still coming in
+        ch = readKey(finder.isSearching() ? FINDER_POLL_MS : -1);
+        switch(ch) {
+            case ERR: // Nothing typed, show what has streamed in since
+                break;
+            case KEY_RESIZE:
+                resizeForm();
+                resizePanels();
+                placeList();
+                break;
+            case KEY_UP:
+            case 16: // Ctrl+P
+                selected = std::max(selected - 1, 0);
+                break;
+            case KEY_DOWN:
+            case 14: // Ctrl+N
+                selected++;
+                break;
+            case 10: // Enter Key (jump to the selected match)
+                chosen = !shown.empty();
+                if(chosen) {
+                    choice = shown[selected];
+                }
+                exit = true;
+                break;
+            case KEY_F(1): // Cancel form input
+                exit = true;
+                break;
+            default:
+                if(isTypedChar(ch)) {
+                    handleInput(ch);
+                    selected = 0;
+                    finder.search(buffer);
+                }
+                break;
+        }
+    }
+
+    // Make cursor invisible after typing
+    curs_set(0);
+
+    return trimWhitespace(buffer);
+}
+
+bool FinderForm::isTypedChar(int ch) {
+    return ch == KEY_BACKSPACE || ch == 127 || (ch >= ' ' && ch <= '~');
+}
+
+void FinderForm::drawList() {
+    Point ul(0, 0); Point lr(listColumns - 1, listLines - 1);
+    Point innerUl(1, 1); Point innerLr(listColumns - 2, listLines - 2);
+    clearBox(Box(innerUl, innerLr), list);
+    drawBox(Box(ul, lr), list);
+    drawCenteredStringAtPoint(" Find ", Point(listColumns / 2, 0), list);
+    drawCount();
+
+    shown = finder.best(std::max(listLines - 3, 0));
+    selected = std::max(std::min(selected, (int)shown.size() - 1), 0);
+    int numShown = (int)shown.size();
+    for(int row = 0; row < numShown; row++) {
+        drawResult(shown[row], row, row == selected);
+    }
+
+    wrefresh(list);
+}
+
+void FinderForm::drawCount() {
+    std::string count = std::to_string(finder.getNumMatches()) + "/" +
+                        std::to_string(finder.getNumCandidates());
+    if(finder.isSearching()) {
+        count += "  " + std::to_string(finder.getProgress()) + "%";
+    }
+
+    setAttributes(getAttribute("dim"), list);
+    drawStringAtPoint(count, Point(2, 1), list);
+    unsetAttributes(getAttribute("dim"), list);
+}
+
+void FinderForm::drawResult(FuzzyMatch match, int row, bool isSelected) {
+    int y = row + 2;
+    Section * section = state->getDocument()->getSection(finder.getSection(match.candidate));
+    std::string title = section->title.substr(0, listColumns / 4);
+    int textColumns = std::max(listColumns - 5 - (int)title.size(), 0);
+    std::string_view text = finder.getText(match.candidate).substr(0, textColumns);
+
+    if(isSelected) {
+        setAttributes(getAttribute("reverse"), list);
+    }
+    drawCustomHLineBetweenPoints(' ', Point(1, y), Point(listColumns - 2, y), list);
+    drawStringAtPoint(text, Point(2, y), list);
+
+    // Mark the characters the query matched, as far as they are shown
+    std::vector<int> positions;
+    int score;
+    FuzzyFinder::scoreMatch(finder.getText(match.candidate), finder.getQuery(), score, &positions);
+    int matchAttr = combineAttributes(2, getAttribute("bold"), getAttribute("underline"));
+    setAttributes(matchAttr, list);
+    for(int position : positions) {
+        if(position >= (int)text.size()) { break; }
+        drawCharAtPoint(text[position], Point(2 + position, y), list);
+    }
+    unsetAttributes(matchAttr, list);
+
+    int code = section->colorCode;
+    if(code < 1 || code > 7) { code = 7; }
+    setAttributes(COLOR_PAIR(code), list);
+    drawStringAtPoint(title, Point(listColumns - 2 - (int)title.size(), y), list);
+    unsetAttributes(COLOR_PAIR(code), list);
+
+    if(isSelected) {
+        unsetAttributes(getAttribute("reverse"), list);
+    }
+}
+
+bool FinderForm::getChoice(int & panelIndex, int & itemIndex) {
+    if(!chosen) {
+        return false;
+    }
+
+    panelIndex = finder.getSection(choice.candidate);
+    itemIndex = finder.getPosition(choice.candidate);
+    return true;
+}
@@ -0,0 +1,275 @@
+#include "FuzzyFinder.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "SearchIndex.hpp"
+
+static char lowerByte(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+}
+
+// Bonus for a match at index, for starting a word or a camelCase hump
+static int boundaryBonus(std::string_view text, size_t index) {
+    if(index == 0) { return FUZZY_BONUS_BOUNDARY; }
+
+    unsigned char previous = (unsigned char)text[index - 1];
+    unsigned char current = (unsigned char)text[index];
+    if(!std::isalnum(previous)) {
+        return FUZZY_BONUS_BOUNDARY;
+    }
+    if(std::islower(previous) && std::isupper(current)) {
+        return FUZZY_BONUS_CAMEL_CASE;
+    }
+
+    return 0;
+}
+
+FuzzyFinder::FuzzyFinder(Document * document) :
+    done(true), source(nullptr), cursor(0), scanned(0), finishedWorkers(0), cancelled(false) {
+    int numSections = document->getNumSections();
+    size_t numItems = 0;
+    for(int i = 0; i < numSections; i++) {
+        numItems += document->getSection(i)->getNumItems();
+    }
+
+    candidates.reserve(numItems);
+    for(int i = 0; i < numSections; i++) {
+        document->getSection(i)->visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view text, int index) {
+            candidates.push_back(Candidate{text, (uint32_t)i, (uint32_t)index});
+        });
+    }
+}
+
+FuzzyFinder::~FuzzyFinder() {
+    stop();
+}
+
+void FuzzyFinder::search(std::string newQuery) {
+    stop();
+    query = SearchIndex::lowercase(newQuery);
+    found.clear();
+    scanned = 0;
+
+    // Only queries this one extends can narrow down what it has to score
+    while(!levels.empty() && query.compare(0, levels.back().query.size(), levels.back().query) != 0) {
+        levels.pop_back();
+    }
+    if(query.empty() || (!levels.empty() && levels.back().query == query)) {
+        done = true;
+        return;
+    }
+
+    source = levels.empty() ? nullptr : &levels.back().matches;
+    done = false;
+    cursor = 0;
+    finishedWorkers = 0;
+    cancelled = false;
+
+    size_t total = getSourceSize();
+    if(total < FUZZY_PARALLEL_MIN) {
+        runWorker();
+        finishSearch();
+        return;
+    }
+
+    size_t numWorkers = std::max(1u, std::thread::hardware_concurrency());
+    numWorkers = std::min(numWorkers, (total + FUZZY_BATCH_SIZE - 1) / FUZZY_BATCH_SIZE);
+    for(size_t i = 0; i < numWorkers; i++) {
+        workers.emplace_back(&FuzzyFinder::runWorker, this);
+    }
+}
+
+void FuzzyFinder::runWorker() {
+    size_t total = getSourceSize();
+    std::vector<FuzzyMatch> batch;
+    while(!cancelled) {
+        size_t begin = cursor.fetch_add(FUZZY_BATCH_SIZE);
+        if(begin >= total) { break; }
+        size_t end = std::min(begin + FUZZY_BATCH_SIZE, total);
+
+        batch.clear();
+        for(size_t i = begin; i < end; i++) {
+            uint32_t candidate = source == nullptr ? (uint32_t)i : (*source)[i].candidate;
+            int score;
+            if(scoreMatch(candidates[candidate].text, query, score)) {
+                batch.push_back(FuzzyMatch{candidate, score});
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(foundLock);
+        found.insert(found.end(), batch.begin(), batch.end());
+        scanned += end - begin;
+    }
+
+    finishedWorkers++;
+}
+
+void FuzzyFinder::collect() {
+    if(done || workers.empty() || finishedWorkers < (int)workers.size()) {
+        return;
+    }
+
+    finishSearch();
+}
+
+void FuzzyFinder::finishSearch() {
+    for(std::thread & worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    levels.push_back(Level{query, std::move(found)});
+    found.clear();
+    done = true;
+}
+
+void FuzzyFinder::stop() {
+    if(workers.empty()) { return; }
+
+    cancelled = true;
+    for(std::thread & worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+bool FuzzyFinder::isSearching() {
+    return !done;
+}
+
+size_t FuzzyFinder::getSourceSize() {
+    return source == nullptr ? candidates.size() : source->size();
+}
+
+bool FuzzyFinder::ranksBefore(const FuzzyMatch & a, const FuzzyMatch & b) {
+    if(a.score != b.score) {
+        return a.score > b.score;
+    }
+
+    // Between equal matches, the shorter item matched more of itself
+    size_t aSize = candidates[a.candidate].text.size();
+    size_t bSize = candidates[b.candidate].text.size();
+    if(aSize != bSize) {
+        return aSize < bSize;
+    }
+
+    return a.candidate < b.candidate;
+}
+
+const std::vector<FuzzyMatch> & FuzzyFinder::getResults() {
+    return done ? levels.back().matches : found;
+}
+
+std::vector<FuzzyMatch> FuzzyFinder::best(size_t count) {
+    std::vector<FuzzyMatch> top;
+    if(query.empty()) {
+        count = std::min(count, candidates.size());
+        for(size_t i = 0; i < count; i++) {
+            top.push_back(FuzzyMatch{(uint32_t)i, 0});
+        }
+        return top;
+    }
+
+    std::lock_guard<std::mutex> guard(foundLock);
+    const std::vector<FuzzyMatch> & results = getResults();
+    top.resize(std::min(count, results.size()));
+    std::partial_sort_copy(results.begin(), results.end(), top.begin(), top.end(),
+                           [this](const FuzzyMatch & a, const FuzzyMatch & b) {
+        return ranksBefore(a, b);
+    });
+
+    return top;
+}
+
+size_t FuzzyFinder::getNumMatches() {
+    if(query.empty()) {
+        return candidates.size();
+    }
+
+    std::lock_guard<std::mutex> guard(foundLock);
+    return getResults().size();
+}
+
+int FuzzyFinder::getProgress() {
+    size_t total = getSourceSize();
+    if(done || total == 0) {
+        return 100;
+    }
+
+    return (int)(scanned * 100 / total);
+}
+
+size_t FuzzyFinder::getNumCandidates() {
+    return candidates.size();
+}
+
+std::string_view FuzzyFinder::getText(uint32_t candidate) {
+    return candidates[candidate].text;
+}
+
+int FuzzyFinder::getSection(uint32_t candidate) {
+    return (int)candidates[candidate].section;
+}
+
+int FuzzyFinder::getPosition(uint32_t candidate) {
+    return (int)candidates[candidate].position;
+}
+
+std::string FuzzyFinder::getQuery() {
+    return query;
+}
+
+bool FuzzyFinder::scoreMatch(std::string_view text, std::string_view pattern, int & score,
+                             std::vector<int> * positions) {
+    // Find where the leftmost match ends, then walk back from there to the
+    // latest start, for the tightest window around the match
+    size_t matched = 0;
+    size_t end = 0;
+    for(size_t i = 0; i < text.size() && matched < pattern.size(); i++) {
+        if(lowerByte(text[i]) == pattern[matched]) {
+            matched++;
+            end = i + 1;
+        }
+    }
+    if(matched < pattern.size()) {
+        return false;
+    }
+
+    size_t start = end;
+    while(matched > 0) {
+        start--;
+        if(lowerByte(text[start]) == pattern[matched - 1]) {
+            matched--;
+        }
+    }
+
+    score = 0;
+    bool consecutive = false;
+    bool inGap = false;
+    for(size_t i = start; i < end; i++) {
+        if(matched < pattern.size() && lowerByte(text[i]) == pattern[matched]) {
+            int bonus = boundaryBonus(text, i);
+            if(consecutive) {
+                bonus = std::max(bonus, FUZZY_BONUS_CONSECUTIVE);
+            }
+            if(matched == 0) {
+                bonus *= FUZZY_FIRST_CHAR_MULTIPLIER;
+            }
+            score += FUZZY_SCORE_MATCH + bonus;
+
+            if(positions != nullptr) {
+                positions->push_back((int)i);
+            }
+            matched++;
+            consecutive = true;
+            inGap = false;
+        } else {
+            score -= inGap ? FUZZY_PENALTY_GAP_EXTENSION : FUZZY_PENALTY_GAP_START;
+            consecutive = false;
+            inGap = true;
+        }
+    }
+
+    return true;
+}
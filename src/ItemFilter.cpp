@@ -0,0 +1,203 @@
+#include "ItemFilter.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#include "ItemTokens.hpp"
+#include "SearchIndex.hpp"
+
+ItemFilter::ItemFilter(std::string specIn) : spec(specIn), kind(Kind::SUBSTRING), today(ItemTokens::today()) {
+    needle = SearchIndex::lowercase(spec);
+
+    if(spec.size() > 2 && spec.front() == '/' && spec.back() == '/') {
+        try {
+            expression = std::regex(spec.substr(1, spec.size() - 2),
+                                    std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+            kind = Kind::REGEX;
+        } catch(std::regex_error& e) {
+            kind = Kind::SUBSTRING;
+        }
+    } else if(readTerms()) {
+        kind = Kind::TERMS;
+    }
+}
+
+bool ItemFilter::readTerms() {
+    // Every word has to be a term, otherwise the whole thing is text
+    size_t at = 0;
+    while(at < needle.size()) {
+        size_t end = needle.find(' ', at);
+        if(end == std::string::npos) {
+            end = needle.size();
+        }
+
+        if(end > at) {
+            Term term;
+            if(!readTerm(std::string_view(needle).substr(at, end - at), term)) {
+                terms.clear();
+                return false;
+            }
+            terms.push_back(term);
+        }
+        at = end + 1;
+    }
+
+    return !terms.empty();
+}
+
+bool ItemFilter::readTerm(std::string_view word, Term & term) {
+    term.kind = word[0];
+    term.priority = 0;
+    term.firstDate = 1;
+    term.lastDate = INT_MAX;
+
+    if(term.kind == '#') {
+        if(word.size() < 2) { return false; }
+        for(char ch : word.substr(1)) {
+            if(!ItemTokens::isTagChar(ch)) { return false; }
+        }
+        term.tag = std::string(word.substr(1));
+        return true;
+    }
+    if(term.kind == '!') {
+        if(word.size() != 2 || word[1] < '1' || word[1] > '9') { return false; }
+        term.priority = word[1] - '0';
+        return true;
+    }
+    if(term.kind != '@') {
+        return false;
+    }
+
+    if(word == "@overdue") {
+        term.lastDate = ItemTokens::addDays(today, -1);
+    } else if(word == "@today") {
+        term.firstDate = today;
+        term.lastDate = today;
+    } else if(word == "@week") {
+        term.firstDate = today;
+        term.lastDate = ItemTokens::addDays(today, 6);
+    } else if(word != "@due") {
+        return false;
+    }
+    return true;
+}
+
+std::string ItemFilter::getSpec() {
+    return spec;
+}
+
+bool ItemFilter::matches(Section & section, int index) {
+    if(kind != Kind::TERMS) {
+        return matchesText(section.getItem(index));
+    }
+
+    for(const Term & term : terms) {
+        if(!matchesTerm(section, index, term)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ItemFilter::matchesTerm(Section & section, int index, const Term & term) {
+    switch(term.kind) {
+        case '#':
+            return section.itemHasTag(index, term.tag);
+        case '!': {
+            int priority = section.getPriority(index);
+            return priority != 0 && priority <= term.priority;
+        }
+        default: {
+            int dueDate = ItemTokens::resolveDate(section.getDueDate(index), today);
+            return dueDate != 0 && dueDate >= term.firstDate && dueDate <= term.lastDate;
+        }
+    }
+}
+
+bool ItemFilter::matchesText(std::string_view item) {
+    if(kind == Kind::REGEX) {
+        return std::regex_search(item.begin(), item.end(), expression);
+    }
+    return SearchIndex::findIgnoringCase(item, needle) != std::string_view::npos;
+}
+
+void ItemFilter::rebuild(Section & section) {
+    visible.clear();
+
+    int numItems = section.getNumItems();
+    if(kind == Kind::TERMS) {
+        for(int index = 0; index < numItems; index++) {
+            if(matches(section, index)) {
+                visible.push_back(index);
+            }
+        }
+        return;
+    }
+
+    section.visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view item, int index) {
+        if(matchesText(item)) {
+            visible.push_back(index);
+        }
+    });
+}
+
+void ItemFilter::shiftFrom(size_t first, int by) {
+    size_t numVisible = visible.size();
+    for(size_t i = first; i < numVisible; i++) {
+        visible[i] += by;
+    }
+}
+
+void ItemFilter::itemInserted(Section & section, int index) {
+    size_t at = std::lower_bound(visible.begin(), visible.end(), index) - visible.begin();
+    shiftFrom(at, 1);
+    if(matches(section, index)) {
+        visible.insert(visible.begin() + at, index);
+    }
+}
+
+void ItemFilter::itemErased(int index) {
+    size_t at = std::lower_bound(visible.begin(), visible.end(), index) - visible.begin();
+    if(at < visible.size() && visible[at] == index) {
+        visible.erase(visible.begin() + at);
+    }
+    shiftFrom(at, -1);
+}
+
+void ItemFilter::itemChanged(Section & section, int index) {
+    auto at = std::lower_bound(visible.begin(), visible.end(), index);
+    bool wasVisible = at != visible.end() && *at == index;
+    bool nowVisible = matches(section, index);
+    if(wasVisible && !nowVisible) {
+        visible.erase(at);
+    } else if(!wasVisible && nowVisible) {
+        visible.insert(at, index);
+    }
+}
+
+void ItemFilter::itemsSwapped(int a, int b) {
+    // The items keep whether they match, they only trade places
+    bool aVisible = isVisible(a);
+    if(aVisible == isVisible(b)) { return; }
+
+    int from = aVisible ? a : b;
+    int to = aVisible ? b : a;
+    visible.erase(std::lower_bound(visible.begin(), visible.end(), from));
+    visible.insert(std::lower_bound(visible.begin(), visible.end(), to), to);
+}
+
+int ItemFilter::getNumVisible() {
+    return (int)visible.size();
+}
+
+int ItemFilter::toItemIndex(int visibleIndex) {
+    return visible[visibleIndex];
+}
+
+int ItemFilter::toVisibleIndex(int index) {
+    return (int)(std::lower_bound(visible.begin(), visible.end(), index) - visible.begin());
+}
+
+bool ItemFilter::isVisible(int index) {
+    return std::binary_search(visible.begin(), visible.end(), index);
+}
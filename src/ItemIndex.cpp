@@ -0,0 +1,34 @@
+#include "ItemIndex.hpp"
+
+ItemIndex::ItemIndex() : active(false) {}
+
+bool ItemIndex::isActive() {
+    return active;
+}
+
+void ItemIndex::activate() {
+    locations.clear();
+    active = true;
+}
+
+void ItemIndex::add(uint64_t id, Section * section, int position) {
+    if(!active) { return; }
+
+    locations[id] = ItemLocation{section, position};
+}
+
+void ItemIndex::remove(uint64_t id) {
+    if(!active) { return; }
+
+    locations.erase(id);
+}
+
+bool ItemIndex::find(uint64_t id, ItemLocation & location) {
+    auto found = locations.find(id);
+    if(found == locations.end()) {
+        return false;
+    }
+
+    location = found->second;
+    return true;
+}
@@ -0,0 +1,146 @@
+#include "ItemMetadata.hpp"
+
+#include "SearchIndex.hpp"
+
+ItemMetadata::ItemMetadata() : pool(std::make_shared<std::vector<ItemToken>>()) {}
+
+ItemMetadata::Facts ItemMetadata::read(std::string_view item) {
+    int dueDate, priority;
+    std::vector<ItemToken> tokens;
+    ItemTokens::findTokens(item, dueDate, priority, tokens);
+
+    // Most items have no tokens and take nothing from the pool
+    uint32_t tokenRun = 0;
+    if(tokens.size() > UINT16_MAX) {
+        tokens.resize(UINT16_MAX);
+    }
+    if(!tokens.empty()) {
+        // Run 0 is never handed out, so it can mean none
+        if(pool->empty()) {
+            pool->push_back(ItemToken{0, 0, DUE_TOKEN});
+        }
+        tokenRun = (uint32_t)pool->size();
+        pool->push_back(ItemToken{0, (uint16_t)tokens.size(), DUE_TOKEN});
+        pool->insert(pool->end(), tokens.begin(), tokens.end());
+    }
+
+    return Facts{dueDate, (uint8_t)priority, tokenRun};
+}
+
+void ItemMetadata::setFacts(size_t index, Facts facts) {
+    dueDates.set(index, facts.dueDate);
+    priorities.set(index, facts.priority);
+    tokenRuns.set(index, facts.tokenRun);
+}
+
+void ItemMetadata::push_back(std::string_view item) {
+    Facts facts = read(item);
+    dueDates.push_back(facts.dueDate);
+    priorities.push_back(facts.priority);
+    tokenRuns.push_back(facts.tokenRun);
+}
+
+void ItemMetadata::insert(size_t index, std::string_view item) {
+    if(index >= size()) { return; }
+
+    Facts facts = read(item);
+    dueDates.insert(index, facts.dueDate);
+    priorities.insert(index, facts.priority);
+    tokenRuns.insert(index, facts.tokenRun);
+}
+
+void ItemMetadata::set(size_t index, std::string_view item) {
+    if(index >= size()) { return; }
+
+    setFacts(index, read(item));
+}
+
+void ItemMetadata::erase(size_t index) {
+    if(index >= size()) { return; }
+
+    dueDates.erase(index);
+    priorities.erase(index);
+    tokenRuns.erase(index);
+}
+
+void ItemMetadata::swap(size_t a, size_t b) {
+    dueDates.swap(a, b);
+    priorities.swap(a, b);
+    tokenRuns.swap(a, b);
+}
+
+void ItemMetadata::reorder(const std::vector<int> & positions) {
+    if(size() < positions.size()) {
+        dueDates.clear();
+        priorities.clear();
+        tokenRuns.clear();
+        return;
+    }
+
+    std::vector<Facts> rows(positions.size());
+    size_t row = 0;
+    dueDates.visitFrom(0, [&](int32_t dueDate) {
+        rows[row++].dueDate = dueDate;
+        return true;
+    });
+    row = 0;
+    priorities.visitFrom(0, [&](uint8_t priority) {
+        rows[row++].priority = priority;
+        return true;
+    });
+    row = 0;
+    tokenRuns.visitFrom(0, [&](uint32_t tokenRun) {
+        rows[row++].tokenRun = tokenRun;
+        return true;
+    });
+
+    dueDates.clear();
+    priorities.clear();
+    tokenRuns.clear();
+    for(int position : positions) {
+        dueDates.push_back(rows[position].dueDate);
+        priorities.push_back(rows[position].priority);
+        tokenRuns.push_back(rows[position].tokenRun);
+    }
+}
+
+size_t ItemMetadata::size() const {
+    return dueDates.size();
+}
+
+int ItemMetadata::getDueDate(size_t index) const {
+    return dueDates[index];
+}
+
+int ItemMetadata::getPriority(size_t index) const {
+    return priorities[index];
+}
+
+const ItemToken * ItemMetadata::getTokens(size_t index, int & numTokens) const {
+    uint32_t tokenRun = tokenRuns[index];
+    if(tokenRun == 0) {
+        numTokens = 0;
+        return nullptr;
+    }
+
+    numTokens = (*pool)[tokenRun].length;
+    return pool->data() + tokenRun + 1;
+}
+
+bool ItemMetadata::hasTag(size_t index, std::string_view item, std::string_view tag) const {
+    int numTokens;
+    const ItemToken * tokens = getTokens(index, numTokens);
+    for(int i = 0; i < numTokens; i++) {
+        if(tokens[i].kind != TAG_TOKEN || tokens[i].length != tag.size() + 1) {
+            continue;
+        }
+
+        // The span includes the '#'
+        std::string_view name = item.substr(tokens[i].start + 1, tag.size());
+        if(SearchIndex::findIgnoringCase(name, tag) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,252 @@
+#include "ItemSorter.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <thread>
+
+#include "ItemTokens.hpp"
+
+static const char * ORDER_NAMES[] = {"none", "alpha", "natural", "due", "priority"};
+
+static char lowerByte(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+}
+
+// The first eight bytes of key as a big endian number, so comparing two of
+// them compares those bytes
+static uint64_t packPrefix(std::string_view key) {
+    uint64_t prefix = 0;
+    for(size_t i = 0; i < 8; i++) {
+        prefix <<= 8;
+        if(i < key.size()) {
+            prefix |= (unsigned char)key[i];
+        }
+    }
+
+    return prefix;
+}
+
+bool ItemSorter::comparesText(SortOrder order) {
+    return order != BY_DUE_DATE && order != BY_PRIORITY;
+}
+
+uint64_t ItemSorter::makeKey(Section & section, int index, SortOrder order, std::string & collated) {
+    switch(order) {
+        case BY_DUE_DATE:
+            return makeNumericKey(section.getDueDate(index));
+        case BY_PRIORITY:
+            return makeNumericKey(section.getPriority(index));
+        default:
+            return collate(section.getItem(index), order == NATURAL, collated);
+    }
+}
+
+uint64_t ItemSorter::makeNumericKey(int value) {
+    // Items without a due date or priority have 0 and go last
+    return value == 0 ? UINT64_MAX : (uint64_t)value;
+}
+
+uint64_t ItemSorter::collate(std::string_view item, bool natural, std::string & collated) {
+    size_t start = collated.size();
+    size_t numChars = item.size();
+    for(size_t i = 0; i < numChars; i++) {
+        if(!natural || item[i] < '0' || item[i] > '9') {
+            collated += lowerByte(item[i]);
+            continue;
+        }
+
+        // A run of digits becomes '0', its length without leading zeros and
+        // then the digits, so shorter numbers sort first and equal lengths
+        // sort digit by digit
+        size_t end = i;
+        while(end < numChars && item[end] >= '0' && item[end] <= '9') {
+            end++;
+        }
+        while(i < end - 1 && item[i] == '0') {
+            i++;
+        }
+        if(item[i] == '0') {
+            i++;
+        }
+        collated += '0';
+        collated += (char)std::min<size_t>(end - i, UCHAR_MAX);
+        collated.append(item.substr(i, end - i));
+        i = end - 1;
+    }
+
+    return packPrefix(std::string_view(collated).substr(start));
+}
+
+int ItemSorter::compareKeys(const Key & a, const Key & b) {
+    if(a.prefix != b.prefix) {
+        return a.prefix < b.prefix ? -1 : 1;
+    }
+
+    return a.collated.compare(b.collated);
+}
+
+bool ItemSorter::keyBefore(const Key & a, const Key & b) {
+    int compared = compareKeys(a, b);
+    if(compared != 0) {
+        return compared < 0;
+    }
+
+    return a.index < b.index;
+}
+
+void ItemSorter::buildPart(std::vector<std::string_view> & items, std::vector<int> & values, SortOrder order,
+                           size_t begin, size_t end, std::vector<Key> & keys, std::string & arena) {
+    if(!comparesText(order)) {
+        for(size_t i = begin; i < end; i++) {
+            keys[i] = Key{makeNumericKey(values[i]), std::string_view(), (uint32_t)i};
+        }
+        std::sort(keys.begin() + begin, keys.begin() + end, keyBefore);
+        return;
+    }
+
+    // Collated text goes in one buffer per part, and is only looked at once
+    // the buffer has stopped growing
+    std::vector<size_t> starts;
+    starts.reserve(end - begin + 1);
+    for(size_t i = begin; i < end; i++) {
+        starts.push_back(arena.size());
+        uint64_t prefix = collate(items[i], order == NATURAL, arena);
+        keys[i] = Key{prefix, std::string_view(), (uint32_t)i};
+    }
+    starts.push_back(arena.size());
+
+    for(size_t i = begin; i < end; i++) {
+        size_t start = starts[i - begin];
+        keys[i].collated = std::string_view(arena).substr(start, starts[i - begin + 1] - start);
+    }
+    std::sort(keys.begin() + begin, keys.begin() + end, keyBefore);
+}
+
+std::vector<int> ItemSorter::sortedPositions(Section & section, SortOrder order) {
+    // Text is read in place, due dates and priorities straight from their
+    // columns
+    std::vector<std::string_view> items;
+    std::vector<int> values;
+    size_t numItems = section.getNumItems();
+    if(comparesText(order)) {
+        items.reserve(numItems);
+        section.visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view item, int) {
+            items.push_back(item);
+        });
+    } else if(order == BY_DUE_DATE) {
+        values.reserve(numItems);
+        section.getMetadata().visitDueDates([&](int dueDate) {
+            values.push_back(dueDate);
+        });
+    } else {
+        values.reserve(numItems);
+        section.getMetadata().visitPriorities([&](int priority) {
+            values.push_back(priority);
+        });
+    }
+
+    size_t numParts = 1;
+    if(numItems >= SORT_PARALLEL_MIN) {
+        numParts = std::max(1u, std::thread::hardware_concurrency());
+        numParts = std::min(numParts, numItems / (SORT_PARALLEL_MIN / 2));
+    }
+
+    std::vector<Key> keys(numItems);
+    std::vector<std::string> arenas(numParts);
+    std::vector<size_t> bounds;
+    for(size_t part = 0; part <= numParts; part++) {
+        bounds.push_back(numItems * part / numParts);
+    }
+
+    std::vector<std::thread> workers;
+    for(size_t part = 1; part < numParts; part++) {
+        workers.emplace_back(buildPart, std::ref(items), std::ref(values), order, bounds[part], bounds[part + 1],
+                             std::ref(keys), std::ref(arenas[part]));
+    }
+    buildPart(items, values, order, bounds[0], bounds[1], keys, arenas[0]);
+    for(std::thread & worker : workers) {
+        worker.join();
+    }
+
+    // Merge neighbouring runs until one is left, every pair on its own thread
+    std::vector<Key> merged(numItems);
+    while(bounds.size() > 2) {
+        std::vector<size_t> mergedBounds;
+        workers.clear();
+        for(size_t run = 0; run + 1 < bounds.size(); run += 2) {
+            size_t begin = bounds[run];
+            size_t middle = bounds[run + 1];
+            size_t end = run + 2 < bounds.size() ? bounds[run + 2] : middle;
+            mergedBounds.push_back(begin);
+            workers.emplace_back([&keys, &merged, begin, middle, end]() {
+                std::merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + middle,
+                           keys.begin() + end, merged.begin() + begin, keyBefore);
+            });
+        }
+        mergedBounds.push_back(numItems);
+        for(std::thread & worker : workers) {
+            worker.join();
+        }
+
+        keys.swap(merged);
+        bounds = mergedBounds;
+    }
+
+    std::vector<int> positions;
+    positions.reserve(numItems);
+    for(Key & key : keys) {
+        positions.push_back((int)key.index);
+    }
+
+    return positions;
+}
+
+int ItemSorter::findInsertPosition(Section & section, SortOrder order, int index) {
+    std::string collated;
+    Key key{makeKey(section, index, order, collated), std::string_view(), 0};
+    key.collated = collated;
+
+    // Search the other items, skipping over the one being placed
+    int low = 0;
+    int high = section.getNumItems() - 1;
+    std::string otherCollated;
+    while(low < high) {
+        int middle = low + (high - low) / 2;
+        otherCollated.clear();
+        int other = middle < index ? middle : middle + 1;
+        Key otherKey{makeKey(section, other, order, otherCollated), std::string_view(), 0};
+        otherKey.collated = otherCollated;
+        if(compareKeys(key, otherKey) < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    return low;
+}
+
+int ItemSorter::compareItemsAt(Section & section, int a, int b, SortOrder order) {
+    std::string collatedA, collatedB;
+    Key keyA{makeKey(section, a, order, collatedA), std::string_view(), 0};
+    Key keyB{makeKey(section, b, order, collatedB), std::string_view(), 0};
+    keyA.collated = collatedA;
+    keyB.collated = collatedB;
+
+    return compareKeys(keyA, keyB);
+}
+
+std::string ItemSorter::getOrderName(SortOrder order) {
+    return ORDER_NAMES[order];
+}
+
+SortOrder ItemSorter::getOrderFromName(std::string_view name) {
+    for(int order = ALPHABETICAL; order <= BY_PRIORITY; order++) {
+        if(name == ORDER_NAMES[order]) {
+            return (SortOrder)order;
+        }
+    }
+
+    return UNSORTED;
+}
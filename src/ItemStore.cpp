@@ -0,0 +1,86 @@
+#include "ItemStore.hpp"
+
+#include "Hash.hpp"
+
+ItemArena::ItemArena() : blockUsed(0), blockCapacity(0), bytesStored(0) {}
+
+ItemRef ItemArena::store(std::string_view text) {
+    if(text.size() <= INLINE_ITEM_BYTES) {
+        return ItemRef::referTo(text);
+    }
+
+    char * copy = allocate(text.size());
+    memcpy(copy, text.data(), text.size());
+    bytesStored += text.size();
+
+    return ItemRef::referTo(std::string_view(copy, text.size()));
+}
+
+ItemRef ItemArena::intern(std::string_view text) {
+    if(text.size() <= INLINE_ITEM_BYTES) {
+        return ItemRef::referTo(text);
+    }
+
+    // Keep the table at most half full so probes stay short
+    if((interned.size() + 1) * 2 > table.size()) {
+        growTable();
+    }
+
+    size_t slot = findSlot(text, hashBytes(text));
+    if(table[slot] != 0) {
+        return interned[table[slot] - 1];
+    }
+
+    ItemRef ref = store(text);
+    interned.push_back(ref);
+    table[slot] = (uint32_t)interned.size();
+
+    return ref;
+}
+
+size_t ItemArena::getBytesStored() {
+    return bytesStored;
+}
+
+char * ItemArena::allocate(size_t size) {
+    // Text too big to share a block gets one of its own, behind the current
+    // block so the space left in that one isn't lost
+    if(size > ITEM_ARENA_BLOCK_BYTES / 4) {
+        std::unique_ptr<char[]> block(new char[size]);
+        char * data = block.get();
+        blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1), std::move(block));
+        return data;
+    }
+
+    if(blockUsed + size > blockCapacity) {
+        blocks.emplace_back(new char[ITEM_ARENA_BLOCK_BYTES]);
+        blockUsed = 0;
+        blockCapacity = ITEM_ARENA_BLOCK_BYTES;
+    }
+
+    char * data = blocks.back().get() + blockUsed;
+    blockUsed += size;
+
+    return data;
+}
+
+void ItemArena::growTable() {
+    size_t capacity = table.empty() ? 64 : table.size() * 2;
+    table.assign(capacity, 0);
+
+    uint32_t numInterned = (uint32_t)interned.size();
+    for(uint32_t i = 0; i < numInterned; i++) {
+        std::string_view text = interned[i].view();
+        table[findSlot(text, hashBytes(text))] = i + 1;
+    }
+}
+
+size_t ItemArena::findSlot(std::string_view text, uint64_t hash) {
+    size_t mask = table.size() - 1;
+    size_t slot = (size_t)hash & mask;
+    while(table[slot] != 0 && interned[table[slot] - 1].view() != text) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
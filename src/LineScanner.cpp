@@ -0,0 +1,207 @@
+#include "LineScanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINE_SCANNER_X86
+#endif
+
+/////////////////////////////// SCALAR KERNELS ///////////////////////////////
+
+static void findNewlinesScalar(const char * text, size_t begin, size_t end, std::vector<size_t> & out) {
+    for(size_t i = begin; i < end; i++) {
+        if(text[i] == '\n') {
+            out.push_back(i);
+        }
+    }
+}
+
+static size_t findPairScalar(const char * text, size_t begin, size_t end, char first, char second) {
+    for(size_t i = begin; i + 1 < end; i++) {
+        if(text[i] == first && text[i + 1] == second) {
+            return i;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+//////////////////////////////// SIMD KERNELS ////////////////////////////////
+
+#ifdef LINE_SCANNER_X86
+
+// Turn each set bit of a match mask into an offset, lowest bit first
+static inline void emitMaskOffsets(unsigned mask, size_t base, std::vector<size_t> & out) {
+    while(mask != 0) {
+        out.push_back(base + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+}
+
+__attribute__((target("sse2")))
+static void findNewlinesSSE2(const char * text, size_t begin, size_t end, std::vector<size_t> & out) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = begin;
+    for(; i + 16 <= end; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        emitMaskOffsets(mask, i, out);
+    }
+
+    findNewlinesScalar(text, i, end, out);
+}
+
+__attribute__((target("sse2")))
+static size_t findPairSSE2(const char * text, size_t begin, size_t end, char first, char second) {
+    // Compare each block against the first byte, and the block shifted by
+    // one against the second, so a match is a bit set in both masks
+    const __m128i firstBytes = _mm_set1_epi8(first);
+    const __m128i secondBytes = _mm_set1_epi8(second);
+    size_t i = begin;
+    for(; i + 17 <= end; i += 16) {
+        __m128i current = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i next = _mm_loadu_si128((const __m128i *)(text + i + 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(current, firstBytes)) &
+                        (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(next, secondBytes));
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return findPairScalar(text, i, end, first, second);
+}
+
+__attribute__((target("avx2")))
+static void findNewlinesAVX2(const char * text, size_t begin, size_t end, std::vector<size_t> & out) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = begin;
+    for(; i + 32 <= end; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        emitMaskOffsets(mask, i, out);
+    }
+
+    findNewlinesSSE2(text, i, end, out);
+}
+
+__attribute__((target("avx2")))
+static size_t findPairAVX2(const char * text, size_t begin, size_t end, char first, char second) {
+    const __m256i firstBytes = _mm256_set1_epi8(first);
+    const __m256i secondBytes = _mm256_set1_epi8(second);
+    size_t i = begin;
+    for(; i + 33 <= end; i += 32) {
+        __m256i current = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i next = _mm256_loadu_si256((const __m256i *)(text + i + 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(current, firstBytes)) &
+                        (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(next, secondBytes));
+        if(mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return findPairSSE2(text, i, end, first, second);
+}
+
+#endif
+
+/////////////////////////////////// DISPATCH /////////////////////////////////
+
+struct ScanKernels {
+
+    LineScanner::Kernel kernel;
+    void (*findNewlines)(const char * text, size_t begin, size_t end, std::vector<size_t> & out);
+    size_t (*findPair)(const char * text, size_t begin, size_t end, char first, char second);
+
+};
+
+static bool cpuSupports(LineScanner::Kernel kernel) {
+#ifdef LINE_SCANNER_X86
+    __builtin_cpu_init();
+    switch(kernel) {
+        case LineScanner::AVX2_KERNEL:
+            return __builtin_cpu_supports("avx2");
+        case LineScanner::SSE2_KERNEL:
+            return __builtin_cpu_supports("sse2");
+        default:
+            return true;
+    }
+#else
+    return kernel == LineScanner::SCALAR_KERNEL;
+#endif
+}
+
+static ScanKernels kernelsFor(LineScanner::Kernel kernel) {
+    switch(kernel) {
+#ifdef LINE_SCANNER_X86
+        case LineScanner::AVX2_KERNEL:
+            return {kernel, findNewlinesAVX2, findPairAVX2};
+        case LineScanner::SSE2_KERNEL:
+            return {kernel, findNewlinesSSE2, findPairSSE2};
+#endif
+        default:
+            return {LineScanner::SCALAR_KERNEL, findNewlinesScalar, findPairScalar};
+    }
+}
+
+static ScanKernels selectKernels() {
+    if(cpuSupports(LineScanner::AVX2_KERNEL)) {
+        return kernelsFor(LineScanner::AVX2_KERNEL);
+    }
+    if(cpuSupports(LineScanner::SSE2_KERNEL)) {
+        return kernelsFor(LineScanner::SSE2_KERNEL);
+    }
+
+    return kernelsFor(LineScanner::SCALAR_KERNEL);
+}
+
+// Chosen once, on first use, even when parser threads race to get here
+static ScanKernels & getKernels() {
+    static ScanKernels kernels = selectKernels();
+    return kernels;
+}
+
+LineScanner::Kernel LineScanner::getKernel() {
+    return getKernels().kernel;
+}
+
+bool LineScanner::useKernel(Kernel kernel) {
+    if(!cpuSupports(kernel)) {
+        return false;
+    }
+
+    getKernels() = kernelsFor(kernel);
+    return true;
+}
+
+const char * LineScanner::getKernelName(Kernel kernel) {
+    switch(kernel) {
+        case AVX2_KERNEL:
+            return "AVX2";
+        case SSE2_KERNEL:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+void LineScanner::findNewlines(std::string_view text, size_t begin, size_t end, std::vector<size_t> & newlines) {
+    end = std::min(end, text.size());
+    if(begin >= end) { return; }
+
+    getKernels().findNewlines(text.data(), begin, end, newlines);
+}
+
+size_t LineScanner::findPair(std::string_view text, size_t begin, char first, char second) {
+    if(begin >= text.size()) {
+        return std::string_view::npos;
+    }
+
+    return getKernels().findPair(text.data(), begin, text.size(), first, second);
+}
+
+size_t LineScanner::findBlankLine(std::string_view text, size_t begin) {
+    return findPair(text, begin, '\n', '\n');
+}
+
+size_t LineScanner::findSectionHeader(std::string_view text, size_t begin) {
+    return findPair(text, begin, '\n', '[');
+}
@@ -1,8 +1,16 @@
 #include "ListEngine.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ItemTokens.hpp"
+
 ListEngine::ListEngine(std::string listPathIn) : listPath(listPathIn) {
     state = new State(listPathIn);
     commandFactory = new CommandFactory(state);
+    autosaveDelay = getAutosaveDelay();
 }
 
 ListEngine::~ListEngine() {
@@ -13,6 +21,11 @@ void ListEngine::init() {
     try {
         createPanels();
         state->setCurrentPanel(0);
+        state->resetHistory();
+        state->getSearchIndex()->build(state->getDocument());
+        state->watchList(listPath);
+        state->setSavedFingerprint(ListSerializer::fingerprintList(state));
+        state->rememberSavedSections();
     } catch(InvalidFileException& e) {
         throw InvalidFileException(e.what());
     } catch(InvalidRatioException& e) {
@@ -22,9 +35,16 @@ void ListEngine::init() {
 
 void ListEngine::createPanels() {
     try {
-        std::vector<Section> sections = getSectionsFromList();
-        std::vector<SectionPanel *> panels = PanelConstructor::constructPanelsFromSections(sections);
+        Document * document = state->getDocument();
+        for(Section & section : getSectionsFromList()) {
+            document->addSection(std::move(section));
+        }
+
+        std::vector<SectionPanel *> panels = PanelConstructor::constructPanelsForDocument(document);
         passPanelsToState(panels);
+        if(DueIndex::upcomingDays() > 0) {
+            state->showUpcoming(PanelConstructor::generateUpcomingBounds());
+        }
     } catch(InvalidFileException& e) {
         throw InvalidFileException(e.what());
     } catch(InvalidRatioException& e) {
@@ -38,7 +58,25 @@ std::vector<Section> ListEngine::getSectionsFromList() {
     try {
         listPath = convertToAbsolutePath(listPath);
         ListParser parser = ListParser(listPath);
-        sections = parser.parseList();
+        bool lazily = lazyLoadingEnabled();
+
+        // A valid sidecar index lets us skip parsing the text entirely
+        ListIndex index(listPath);
+        if(ListIndex::cacheEnabled() && index.load(parser.getFile())) {
+            sections = index.buildSections(parser.getFile(), lazily);
+        } else {
+            if(lazily) {
+                sections = parser.parseListLazily();
+            } else {
+                sections = parser.parseList();
+            }
+
+            if(ListIndex::cacheEnabled()) {
+                writeListIndex(parser, sections);
+            }
+        }
+
+        replayJournal(parser.getFile()->getContents(), sections);
     } catch(InvalidFileException& e) {
         throw InvalidFileException(e.what());
     }
@@ -46,6 +84,33 @@ std::vector<Section> ListEngine::getSectionsFromList() {
     return sections;
 }
 
+void ListEngine::writeListIndex(ListParser & parser, std::vector<Section> & sections) {
+    ListIndex index(listPath);
+    std::string_view contents = parser.getFile()->getContents();
+    std::vector<std::string_view> blocks = parser.getBlocks();
+
+    int numSections = (int)sections.size();
+    for(int i = 0; i < numSections; i++) {
+        index.addSection(sections[i].title, sections[i].colorCode, sections[i].sortOrder, contents, blocks[i]);
+    }
+
+    index.setChecksum(contents);
+    index.save();
+}
+
+void ListEngine::replayJournal(std::string_view contents, std::vector<Section> & sections) {
+    // Edits saved to the journal since the list was last written go on top
+    ListJournal * journal = state->getJournal();
+    journal->attach(listPath, contents);
+    journal->replay(sections);
+}
+
+bool ListEngine::lazyLoadingEnabled() {
+    std::string lazyStr = Config::getInstance().getValueFromKey("LazyLoading");
+
+    return lazyStr == "true";
+}
+
 std::string ListEngine::convertToAbsolutePath(std::string path) {
     if(isRelativePath(path)) {
         std::string userHome = getenv("HOME");
@@ -71,16 +136,281 @@ void ListEngine::passPanelsToState(std::vector<SectionPanel *> panels) {
 }
 
 void ListEngine::run() {
-    int key;
     while(state->userHasNotQuit()) {
         // Handle input first, then render panels
-        key = getch();
-        handleInput(key);
-        renderPanels();
+        handlePendingInput();
+        collectFinishedSaves();
+        autosaveIfDue();
+        reloadListIfChanged();
+        state->refreshUpcomingIfStale();
         renderModeIndicator();
+        renderPanels();
+
+        // Whatever was drawn this time round goes out in one go
+        doupdate();
+
+        if(state->userHasNotQuit()) {
+            state->getEventLoop()->waitForEvents(state->getListWatchFd(), nextWakeup());
+        }
+    }
+}
+
+void ListEngine::handlePendingInput() {
+    // Everything typed since the last frame is handled before the next one
+    int key;
+    while(state->userHasNotQuit() && (key = getch()) != ERR) {
+        handleInput(key);
+    }
+}
+
+std::chrono::steady_clock::time_point ListEngine::nextWakeup() {
+    // Without anything pending we sleep until a key, a resize or a change to
+    // the list wakes us
+    auto now = std::chrono::steady_clock::now();
+    auto wakeup = std::chrono::steady_clock::time_point::max();
+    if(state->hasBackgroundWork()) {
+        wakeup = now + std::chrono::milliseconds(BACKGROUND_POLL_MS);
+    }
+    if(autosaveDelay.count() > 0 && state->hasUnsubmittedChanges()) {
+        wakeup = std::min(wakeup, std::max(state->getLastChangeTime(), lastAutosave) + autosaveDelay);
+    }
+    if(state->getUpcomingPanel() != nullptr) {
+        wakeup = std::min(wakeup, now + std::chrono::seconds(ItemTokens::secondsUntilTomorrow()));
+    }
+
+    return wakeup;
+}
+
+void ListEngine::collectFinishedSaves() {
+    uint64_t generation;
+    if(state->getListWriter()->pollCompleted(generation)) {
+        state->changesSavedAt(generation);
+    }
+
+    // A journal missing an append can't be replayed, so the next save has
+    // to write the whole list again
+    if(state->getListWriter()->pollFailed()) {
+        state->getJournal()->requireCompaction();
+        state->saveFailed();
+    }
+}
+
+void ListEngine::autosaveIfDue() {
+    if(autosaveDelay.count() <= 0 || !state->hasUnsubmittedChanges()) {
+        return;
+    }
+
+    // Wait for the edits to go quiet, and never save more than once per delay
+    auto now = std::chrono::steady_clock::now();
+    if(now - state->getLastChangeTime() < autosaveDelay || now - lastAutosave < autosaveDelay) {
+        return;
+    }
+
+    lastAutosave = now;
+    Command * save = new SaveFileCommand(state);
+    save->execute();
+    delete save;
+}
+
+std::chrono::milliseconds ListEngine::getAutosaveDelay() {
+    std::string delayStr = Config::getInstance().getValueFromKey("AutosaveDelayMs");
+
+    int delay = 0;
+    auto result = std::from_chars(delayStr.data(), delayStr.data() + delayStr.size(), delay);
+    if(result.ec != std::errc() || result.ptr != delayStr.data() + delayStr.size()) {
+        delay = 0;
+    }
+
+    return std::chrono::milliseconds(delay);
+}
+
+void ListEngine::reloadListIfChanged() {
+    if(!state->listChangedOnDisk()) {
+        return;
+    }
+
+    // A list caught halfway through being written just waits for the next
+    // change, the panels stay as they were
+    ListJournal * journal = state->getJournal();
+    bool journaled = journal->hasRecordsOnDisk();
+    std::vector<Section> sections;
+    try {
+        sections = getSectionsFromList();
+    } catch(InvalidFileException& e) {
+        return;
+    }
+
+    if(sections.empty()) {
+        return;
+    }
+
+    // Edits saved to the journal were made to the list as it was. Once the
+    // journal no longer fits, they are carried onto the new list by position
+    // instead, and there is something to save again.
+    bool rebased = journaled && !journal->hasRecordsOnDisk() && journal->rebase(sections);
+
+    // Unsaved edits are carried over a section at a time, and the next save
+    // writes the result over the outside change
+    bool unsaved = state->userHasUnsavedChanges();
+    std::vector<Section> fromDisk;
+    std::vector<int> standsFor;
+    if(unsaved) {
+        fromDisk = sections;
+        sections = mergeUnsavedEdits(fromDisk, standsFor);
+    }
+
+    try {
+        reconcilePanels(sections);
+    } catch(InvalidRatioException& e) {
+        return;
+    }
+
+    if(unsaved) {
+        rememberMergedSections(fromDisk, sections, standsFor);
+        journal->requireCompaction();
+    }
+    if(rebased || unsaved) {
+        state->setSavedFingerprint(0);
+        state->changesMade();
     }
 }
 
+std::vector<Section> ListEngine::mergeUnsavedEdits(std::vector<Section> & fromDisk, std::vector<int> & standsFor) {
+    // Each section as last saved is found again on disk by the title it was
+    // saved under. Sections edited here since win over the outside change,
+    // those only renamed or recolored here keep the items from disk, and
+    // those deleted here stay deleted unless it changed them (or rewrote
+    // the list in place, after which that can't be told).
+    Document * document = state->getDocument();
+    std::unordered_map<Section *, int> counterparts;
+    std::unordered_set<Section *> live;
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        live.insert(document->getSection(i));
+    }
+
+    int numDisk = (int)fromDisk.size();
+    std::vector<Section> merged = fromDisk;
+    std::vector<bool> claimed(numDisk, false);
+    std::vector<bool> dropped(numDisk, false);
+    for(SavedSection & saved : state->getSavedSections()) {
+        int match = -1;
+        for(int i = 0; i < numDisk && match < 0; i++) {
+            if(!claimed[i] && fromDisk[i].title == saved.copy.title) {
+                match = i;
+            }
+        }
+        if(match >= 0) {
+            claimed[match] = true;
+        }
+
+        if(saved.handle == nullptr || live.count(saved.handle) == 0) {
+            if(match >= 0) {
+                dropped[match] = fromDisk[match].hasSameContentsAs(saved.copy);
+            }
+            continue;
+        }
+
+        Section & section = *saved.handle;
+        bool edited = !section.sharesItemsWith(saved.copy);
+        if(match < 0) {
+            if(!edited) {
+                counterparts[saved.handle] = -1;
+            }
+            continue;
+        }
+        counterparts[saved.handle] = match;
+        if(edited) {
+            merged[match] = section;
+            continue;
+        }
+        if(section.title != saved.copy.title) {
+            merged[match].title = section.title;
+        }
+        if(section.colorCode != saved.copy.colorCode) {
+            merged[match].colorCode = section.colorCode;
+        }
+        if(section.sortOrder != saved.copy.sortOrder) {
+            merged[match].sortOrder = section.sortOrder;
+        }
+    }
+
+    std::vector<Section> result;
+    for(int i = 0; i < numDisk; i++) {
+        if(!dropped[i]) {
+            result.push_back(merged[i]);
+            standsFor.push_back(i);
+        }
+    }
+
+    // Sections added here, and edited ones the outside change removed, go
+    // back where they were
+    for(int i = 0; i < numSections; i++) {
+        Section * section = document->getSection(i);
+        if(counterparts.count(section) > 0) {
+            continue;
+        }
+
+        int position = std::min(i, (int)result.size());
+        result.insert(result.begin() + position, *section);
+        standsFor.insert(standsFor.begin() + position, -1);
+    }
+
+    return result;
+}
+
+void ListEngine::rememberMergedSections(std::vector<Section> & fromDisk, std::vector<Section> & merged,
+                                        std::vector<int> & standsFor) {
+    // The list on disk is still the one just read, so that is what later
+    // outside changes are merged against. Sections taken from it as they
+    // were are remembered as they are in the Document now.
+    Document * document = state->getDocument();
+    std::vector<SavedSection> saved;
+    for(Section & section : fromDisk) {
+        saved.push_back(SavedSection{nullptr, section});
+    }
+
+    int numMerged = (int)merged.size();
+    for(int i = 0; i < numMerged; i++) {
+        if(standsFor[i] < 0) {
+            continue;
+        }
+
+        SavedSection & entry = saved[standsFor[i]];
+        entry.handle = document->getSection(i);
+        if(merged[i].sharesContentsWith(entry.copy)) {
+            entry.copy = *entry.handle;
+        }
+    }
+
+    state->setSavedSections(std::move(saved));
+}
+
+void ListEngine::reconcilePanels(std::vector<Section> sections) {
+    SectionPanel * focused = state->getCurrentPanel();
+    int focusedIndex = state->getCurrentPanelIndex();
+
+    std::vector<SectionPanel *> oldPanels = state->getPanels();
+    std::vector<SectionPanel *> panels = PanelConstructor::reconcilePanelsWithSections(oldPanels, sections,
+                                                                                      state->getDocument());
+    state->replacePanels(panels);
+    state->setSavedFingerprint(ListSerializer::fingerprintList(state));
+    state->rememberSavedSections();
+
+    // Stay on the focused section wherever it ended up, or near where it was
+    auto found = std::find(panels.begin(), panels.end(), focused);
+    if(found != panels.end()) {
+        state->setCurrentPanel((int)(found - panels.begin()));
+    } else {
+        state->setCurrentPanel(std::min(focusedIndex, (int)panels.size() - 1));
+    }
+
+    // Steps taken against the old list can't be undone into the new one
+    state->resetHistory();
+    state->refreshSearch();
+    state->refreshUpcoming();
+}
+
 void ListEngine::handleInput(int key) {
     Command * command = commandFactory->getCommandFromKey(key);
     command->execute();
@@ -88,7 +418,16 @@ void ListEngine::handleInput(int key) {
 }
 
 void ListEngine::renderPanels() {
+    // Panels nothing happened to since they were last drawn are left alone,
+    // so waiting for a key draws nothing at all
+    SectionPanel * upcoming = state->getUpcomingPanel();
+    if(upcoming != nullptr && upcoming->isDirty()) {
+        upcoming->drawPanel();
+    }
     for(SectionPanel * panel : state->getPanels()) {
+        if(!panel->isDirty()) {
+            continue;
+        }
         if(state->panelIsFocused(panel)) {
             panel->drawPanelFocused();
         } else {
@@ -98,6 +437,9 @@ void ListEngine::renderPanels() {
 }
 
 void ListEngine::renderModeIndicator() {
+    if(!state->modeIndicatorIsDirty()) {
+        return;
+    }
     clearModeIndicator();
 
     Mode currentMode = state->getMode();
@@ -115,6 +457,11 @@ void ListEngine::renderModeIndicator() {
         default:
             break;
     }
+
+    // The indicator lives on stdscr, which lies under the panels, so it is
+    // queued before them
+    wnoutrefresh(stdscr);
+    state->modeIndicatorDrawn();
 }
 
 void ListEngine::clearModeIndicator() {
@@ -0,0 +1,276 @@
+#include "ListIndex.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "Config.hpp"
+#include "Hash.hpp"
+
+static const char INDEX_MAGIC[8] = {'C', 'S', 'C', 'I', 'D', 'X', '0', '2'};
+
+/*
+ * Small helper for pulling fixed size fields off the front of the mapped
+ * index. Every read is bounds checked, so a truncated or corrupt index just
+ * fails to load instead of reading past the mapping.
+ */
+struct IndexReader {
+
+    std::string_view bytes;
+
+    template <typename T>
+    bool read(T & value) {
+        if(bytes.size() < sizeof(T)) { return false; }
+
+        memcpy(&value, bytes.data(), sizeof(T));
+        bytes.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool readView(std::string_view & value, uint64_t length) {
+        if(bytes.size() < length) { return false; }
+
+        value = bytes.substr(0, length);
+        bytes.remove_prefix(length);
+        return true;
+    }
+
+};
+
+// An order this version doesn't know leaves the section unsorted
+static SortOrder toSortOrder(int32_t order) {
+    return order > UNSORTED && order <= BY_PRIORITY ? (SortOrder)order : UNSORTED;
+}
+
+template <typename T>
+static void appendField(std::string & out, T value) {
+    out.append((const char *)&value, sizeof(T));
+}
+
+ListIndex::ListIndex(std::string listPathIn) :
+    listPath(listPathIn), fileSize(0), mtimeSec(0), mtimeNsec(0), checksum(0),
+    overflow(false) {}
+
+bool ListIndex::cacheEnabled() {
+    std::string cacheStr = Config::getInstance().getValueFromKey("IndexCache");
+
+    return cacheStr != "false";
+}
+
+std::string ListIndex::getIndexPath() {
+    return listPath + ".idx";
+}
+
+bool ListIndex::statList() {
+    struct stat info;
+    if(stat(listPath.c_str(), &info) != 0) {
+        return false;
+    }
+
+    fileSize = (uint64_t)info.st_size;
+    mtimeSec = (int64_t)info.st_mtim.tv_sec;
+    mtimeNsec = (int64_t)info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool ListIndex::load(std::shared_ptr<MappedFile> list) {
+    try {
+        indexFile = std::make_unique<MappedFile>(getIndexPath());
+    } catch(InvalidFileException& e) {
+        return false;
+    }
+
+    if(!readIndex(indexFile->getContents())) {
+        return false;
+    }
+
+    // Cheap checks first, only hash the list once size and mtime agree
+    ListIndex current(listPath);
+    if(!current.statList()) {
+        return false;
+    }
+    if(current.fileSize != fileSize || current.mtimeSec != mtimeSec ||
+       current.mtimeNsec != mtimeNsec || list->getSize() != fileSize) {
+        return false;
+    }
+    if(hashBytes(list->getContents()) != checksum) {
+        return false;
+    }
+
+    return sectionsFitIn(list->getSize());
+}
+
+bool ListIndex::readIndex(std::string_view bytes) {
+    IndexReader reader{bytes};
+
+    char magic[sizeof(INDEX_MAGIC)];
+    for(char & ch : magic) {
+        if(!reader.read(ch)) { return false; }
+    }
+    if(memcmp(magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+
+    uint32_t numSections;
+    if(!reader.read(fileSize) || !reader.read(mtimeSec) || !reader.read(mtimeNsec) ||
+       !reader.read(checksum) || !reader.read(numSections)) {
+        return false;
+    }
+
+    // Item spans are left encoded in the mapping until they are needed
+    sections.clear();
+    for(uint32_t i = 0; i < numSections; i++) {
+        IndexedSection section;
+        uint32_t titleLength;
+        std::string_view title;
+        if(!reader.read(titleLength) || !reader.readView(title, titleLength) ||
+           !reader.read(section.colorCode) || !reader.read(section.sortOrder) ||
+           !reader.read(section.blockOffset) ||
+           !reader.read(section.blockLength) || !reader.read(section.numItems) ||
+           !reader.readView(section.encodedItems, (uint64_t)section.numItems * 8)) {
+            return false;
+        }
+
+        section.title = std::string(title);
+        sections.push_back(std::move(section));
+    }
+
+    return reader.bytes.empty();
+}
+
+bool ListIndex::sectionsFitIn(size_t size) {
+    for(IndexedSection & section : sections) {
+        if(section.blockOffset > size || section.blockLength > size - section.blockOffset) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ListIndex::ItemSpan ListIndex::getEncodedSpan(IndexedSection & section, uint32_t index) {
+    ItemSpan span;
+    memcpy(&span.offset, section.encodedItems.data() + index * 8, sizeof(uint32_t));
+    memcpy(&span.length, section.encodedItems.data() + index * 8 + 4, sizeof(uint32_t));
+
+    return span;
+}
+
+std::vector<Section> ListIndex::buildSections(std::shared_ptr<MappedFile> list, bool lazily) {
+    std::vector<Section> built;
+    built.reserve(sections.size());
+
+    std::string_view contents = list->getContents();
+    for(IndexedSection & indexed : sections) {
+        std::string_view block = contents.substr(indexed.blockOffset, indexed.blockLength);
+        if(lazily) {
+            built.emplace_back(indexed.title, indexed.colorCode, list, block);
+            built.back().sortOrder = toSortOrder(indexed.sortOrder);
+            continue;
+        }
+
+        // substr() clamps, so a bad span can only ever yield a short item
+        Section section(indexed.title, indexed.colorCode);
+        section.sortOrder = toSortOrder(indexed.sortOrder);
+        for(uint32_t i = 0; i < indexed.numItems; i++) {
+            ItemSpan span = getEncodedSpan(indexed, i);
+            section.loadItem(block.substr(std::min<uint64_t>(span.offset, block.size()), span.length));
+        }
+        section.attachOrigin(list, block);
+        built.push_back(std::move(section));
+    }
+
+    return built;
+}
+
+void ListIndex::addSection(std::string title, int colorCode, SortOrder sortOrder, std::string_view contents,
+                           std::string_view block) {
+    uint64_t blockOffset = block.empty() ? 0 : (uint64_t)(block.data() - contents.data());
+    addSection(title, colorCode, sortOrder, blockOffset);
+
+    // Item offsets are stored relative to the block in 32 bits
+    if(block.size() > UINT32_MAX) {
+        overflow = true;
+        return;
+    }
+
+    size_t cursor = 0;
+    while(cursor < block.size()) {
+        size_t newline = block.find('\n', cursor);
+        if(newline == std::string_view::npos) {
+            newline = block.size();
+        }
+
+        addItem((uint32_t)cursor, (uint32_t)(newline - cursor));
+        cursor = newline + 1;
+    }
+}
+
+void ListIndex::addSection(std::string title, int colorCode, SortOrder sortOrder, uint64_t blockOffset) {
+    IndexedSection section;
+    section.title = title;
+    section.colorCode = colorCode;
+    section.sortOrder = sortOrder;
+    section.blockOffset = blockOffset;
+    section.blockLength = 0;
+    section.numItems = 0;
+    sections.push_back(std::move(section));
+}
+
+void ListIndex::addItem(uint32_t offset, uint32_t length) {
+    IndexedSection & section = sections.back();
+    section.items.push_back({offset, length});
+    section.numItems++;
+    section.blockLength = (uint64_t)offset + length;
+}
+
+void ListIndex::setChecksum(std::string_view contents) {
+    checksum = hashBytes(contents);
+}
+
+void ListIndex::save() {
+    if(overflow || !statList()) {
+        return;
+    }
+
+    // Write beside the real index and rename, so readers never see half
+    std::string indexPath = getIndexPath();
+    std::string tempPath = indexPath + ".tmp";
+    std::ofstream outfile(tempPath, std::ios::binary | std::ios::trunc);
+    std::string encoded = encode();
+    outfile.write(encoded.data(), encoded.size());
+    outfile.close();
+
+    if(outfile.fail()) {
+        remove(tempPath.c_str());
+        return;
+    }
+
+    rename(tempPath.c_str(), indexPath.c_str());
+}
+
+std::string ListIndex::encode() {
+    std::string out(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    appendField(out, fileSize);
+    appendField(out, mtimeSec);
+    appendField(out, mtimeNsec);
+    appendField(out, checksum);
+    appendField(out, (uint32_t)sections.size());
+
+    for(IndexedSection & section : sections) {
+        appendField(out, (uint32_t)section.title.size());
+        out.append(section.title);
+        appendField(out, section.colorCode);
+        appendField(out, section.sortOrder);
+        appendField(out, section.blockOffset);
+        appendField(out, section.blockLength);
+        appendField(out, (uint32_t)section.items.size());
+        for(ItemSpan & span : section.items) {
+            appendField(out, span.offset);
+            appendField(out, span.length);
+        }
+    }
+
+    return out;
+}
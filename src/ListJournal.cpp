@@ -0,0 +1,312 @@
+#include "ListJournal.hpp"
+
+#include <charconv>
+#include <memory>
+
+#include "Config.hpp"
+#include "Hash.hpp"
+
+static const std::string JOURNAL_MAGIC = "CSCJNL01";
+
+static bool opHasText(char op) {
+    return op == 'A' || op == 'E' || op == 'T' || op == 'N';
+}
+
+static int numbersForOp(char op) {
+    switch(op) {
+        case 'A': case 'T': case 'N': case 'X':
+            return 1;
+        case 'E': case 'D': case 'C': case 'S':
+            return 2;
+        case 'W': case 'O':
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+// Reads "\t<number>" off the front of a record
+static bool readNumber(std::string_view & line, int & value) {
+    if(line.empty() || line[0] != '\t') { return false; }
+    line.remove_prefix(1);
+
+    size_t end = line.find('\t');
+    if(end == std::string_view::npos) {
+        end = line.size();
+    }
+
+    auto result = std::from_chars(line.data(), line.data() + end, value);
+    if(result.ec != std::errc() || result.ptr != line.data() + end) {
+        return false;
+    }
+
+    line.remove_prefix(end);
+    return true;
+}
+
+ListJournal::ListJournal() :
+    enabled(false), journalBytes(0), baseSize(0), baseChecksum(0), fresh(true),
+    compactionRequired(false) {}
+
+bool ListJournal::journalEnabled() {
+    std::string journalStr = Config::getInstance().getValueFromKey("Journal");
+
+    return journalStr == "true";
+}
+
+void ListJournal::attach(std::string listPath, std::string_view baseContents) {
+    enabled = journalEnabled();
+    journalPath = listPath + ".journal";
+    pending.clear();
+    journalBytes = 0;
+    fresh = true;
+    compactionRequired = false;
+
+    if(enabled) {
+        baseSize = baseContents.size();
+        baseChecksum = hashBytes(baseContents);
+    }
+}
+
+bool ListJournal::replay(std::vector<Section> & sections) {
+    return replayOnto(sections, true);
+}
+
+bool ListJournal::rebase(std::vector<Section> & sections) {
+    if(!replayOnto(sections, false)) { return false; }
+
+    // The journal still names the list it was written against, so the
+    // edits have to be folded into the new one by the next save
+    compactionRequired = true;
+    return true;
+}
+
+bool ListJournal::replayOnto(std::vector<Section> & sections, bool sameBase) {
+    if(!enabled) { return false; }
+
+    std::unique_ptr<MappedFile> journal;
+    try {
+        journal = std::make_unique<MappedFile>(journalPath);
+    } catch(InvalidFileException& e) {
+        return false;
+    }
+
+    // A journal written against another version of the list is left to be
+    // started over by the next save, unless it is being rebased onto this one
+    std::string_view contents = journal->getContents();
+    size_t newline = contents.find('\n');
+    if(newline == std::string_view::npos) {
+        return false;
+    }
+    std::string_view header = contents.substr(0, newline);
+    if(sameBase ? !headerMatches(header) : header.substr(0, JOURNAL_MAGIC.size()) != JOURNAL_MAGIC) {
+        return false;
+    }
+
+    size_t cursor = newline + 1;
+    while(cursor < contents.size()) {
+        size_t end = contents.find('\n', cursor);
+        if(end == std::string_view::npos || !replayRecord(contents.substr(cursor, end - cursor), sections)) {
+            // Whatever follows a bad record can't be trusted, so stop here
+            // and fold what we have back into the list on the next save
+            compactionRequired = true;
+            break;
+        }
+        cursor = end + 1;
+    }
+
+    fresh = false;
+    journalBytes = contents.size();
+    return true;
+}
+
+std::string ListJournal::makeHeader() {
+    return JOURNAL_MAGIC + "\t" + std::to_string(baseSize) + "\t" + std::to_string(baseChecksum) + "\n";
+}
+
+bool ListJournal::headerMatches(std::string_view line) {
+    std::string header = makeHeader();
+
+    return line == std::string_view(header).substr(0, header.size() - 1);
+}
+
+bool ListJournal::replayRecord(std::string_view line, std::vector<Section> & sections) {
+    if(line.empty()) { return false; }
+
+    char op = line[0];
+    line.remove_prefix(1);
+    int count = numbersForOp(op);
+    if(count < 0) { return false; }
+
+    int numbers[3];
+    for(int i = 0; i < count; i++) {
+        if(!readNumber(line, numbers[i])) { return false; }
+    }
+
+    std::string_view text;
+    if(opHasText(op)) {
+        if(line.empty() || line[0] != '\t') { return false; }
+        text = line.substr(1);
+    } else if(!line.empty()) {
+        return false;
+    }
+
+    int numSections = (int)sections.size();
+    bool sectionExists = op != 'N' && numbers[0] >= 0 && numbers[0] < numSections;
+    switch(op) {
+        case 'A':
+            if(!sectionExists) { return false; }
+            sections[numbers[0]].loadItem(text);
+            sections[numbers[0]].keepItemInOrder(sections[numbers[0]].getNumItems() - 1);
+            return true;
+        case 'E':
+            if(!sectionExists || !sections[numbers[0]].hasItemAt(numbers[1])) { return false; }
+            sections[numbers[0]].setItem(numbers[1], text);
+            sections[numbers[0]].keepItemInOrder(numbers[1]);
+            return true;
+        case 'D':
+            if(!sectionExists || !sections[numbers[0]].hasItemAt(numbers[1])) { return false; }
+            sections[numbers[0]].eraseItem(numbers[1]);
+            return true;
+        case 'W':
+            if(!sectionExists || !sections[numbers[0]].hasItemAt(numbers[1]) ||
+               !sections[numbers[0]].hasItemAt(numbers[2])) {
+                return false;
+            }
+            sections[numbers[0]].swapItems(numbers[1], numbers[2]);
+            return true;
+        case 'C':
+            if(!sectionExists) { return false; }
+            sections[numbers[0]].colorCode = numbers[1];
+            return true;
+        case 'T':
+            if(!sectionExists) { return false; }
+            sections[numbers[0]].title = std::string(text);
+            return true;
+        case 'N':
+            sections.emplace_back(std::string(text), numbers[0]);
+            return true;
+        case 'X':
+            if(!sectionExists) { return false; }
+            sections.erase(sections.begin() + numbers[0]);
+            return true;
+        case 'S':
+            if(!sectionExists || numbers[1] < 0 || numbers[1] >= numSections) { return false; }
+            std::swap(sections[numbers[0]], sections[numbers[1]]);
+            return true;
+        case 'O':
+            if(!sectionExists || numbers[1] < UNSORTED || numbers[1] > BY_PRIORITY) { return false; }
+            if(numbers[1] != UNSORTED) {
+                sections[numbers[0]].sortItems((SortOrder)numbers[1]);
+            }
+            sections[numbers[0]].sortOrder = numbers[2] != 0 ? (SortOrder)numbers[1] : UNSORTED;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool ListJournal::isEnabled() {
+    return enabled;
+}
+
+void ListJournal::record(char op, std::vector<int> numbers, std::string_view text) {
+    if(!enabled) { return; }
+
+    pending += op;
+    for(int number : numbers) {
+        pending += '\t';
+        pending += std::to_string(number);
+    }
+    if(opHasText(op)) {
+        pending += '\t';
+        pending.append(text);
+    }
+    pending += '\n';
+}
+
+void ListJournal::recordAddItem(int section, std::string_view item, uint64_t id) {
+    record('A', {section}, std::string(item) + Section::formatItemId(id));
+}
+
+void ListJournal::recordEditItem(int section, int index, std::string_view item) {
+    record('E', {section, index}, item);
+}
+
+void ListJournal::recordDeleteItem(int section, int index) {
+    record('D', {section, index});
+}
+
+void ListJournal::recordSwapItems(int section, int a, int b) {
+    record('W', {section, a, b});
+}
+
+void ListJournal::recordColor(int section, int colorCode) {
+    record('C', {section, colorCode});
+}
+
+void ListJournal::recordTitle(int section, std::string_view title) {
+    record('T', {section}, title);
+}
+
+void ListJournal::recordNewSection(int colorCode, std::string_view title) {
+    record('N', {colorCode}, title);
+}
+
+void ListJournal::recordDeleteSection(int section) {
+    record('X', {section});
+}
+
+void ListJournal::recordSwapSections(int a, int b) {
+    record('S', {a, b});
+}
+
+void ListJournal::recordSort(int section, SortOrder order, bool keep) {
+    record('O', {section, order, keep ? 1 : 0});
+}
+
+bool ListJournal::needsCompaction() {
+    uint64_t threshold = std::max<uint64_t>(JOURNAL_MIN_COMPACT_BYTES, baseSize / 2);
+
+    return compactionRequired || journalBytes + pending.size() > threshold;
+}
+
+void ListJournal::requireCompaction() {
+    compactionRequired = true;
+}
+
+bool ListJournal::hasRecordsOnDisk() {
+    return !fresh && journalBytes > makeHeader().size();
+}
+
+std::string ListJournal::takePendingRecords(bool & truncate) {
+    std::string records;
+    truncate = fresh;
+    if(fresh) {
+        records = makeHeader();
+        fresh = false;
+    }
+
+    records += pending;
+    pending.clear();
+    journalBytes += records.size();
+
+    return records;
+}
+
+void ListJournal::discardPendingRecords() {
+    pending.clear();
+}
+
+void ListJournal::compactedInto(std::string_view newBase) {
+    baseSize = newBase.size();
+    baseChecksum = hashBytes(newBase);
+    pending.clear();
+    journalBytes = 0;
+    fresh = true;
+    compactionRequired = false;
+}
+
+std::string ListJournal::getPath() {
+    return journalPath;
+}
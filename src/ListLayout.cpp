@@ -0,0 +1,45 @@
+#include "ListLayout.hpp"
+
+ListLayout::ListLayout() : size(0) {}
+
+void ListLayout::appendText(std::string_view bytes) {
+    if(bytes.empty()) { return; }
+
+    // Neighbouring text shares a piece, so the writer can write it in one go
+    if(!pieces.empty() && pieces.back().source == nullptr &&
+       pieces.back().offset + pieces.back().length == text.size()) {
+        pieces.back().length += bytes.size();
+    } else {
+        pieces.push_back({nullptr, (uint64_t)text.size(), (uint64_t)bytes.size()});
+    }
+
+    text.append(bytes);
+    size += bytes.size();
+}
+
+void ListLayout::appendMapped(std::shared_ptr<MappedFile> source, std::string_view range) {
+    if(range.empty()) { return; }
+
+    uint64_t offset = (uint64_t)(range.data() - source->getContents().data());
+    pieces.push_back({source, offset, (uint64_t)range.size()});
+    size += range.size();
+}
+
+void ListLayout::addSection(std::string title, int colorCode, SortOrder sortOrder, uint64_t blockOffset,
+                            uint64_t blockLength) {
+    sections.push_back({title, colorCode, sortOrder, blockOffset, blockLength});
+}
+
+std::string ListLayout::flatten() {
+    std::string flat;
+    flat.reserve(size);
+    for(Piece & piece : pieces) {
+        if(piece.source == nullptr) {
+            flat.append(text, piece.offset, piece.length);
+        } else {
+            flat.append(piece.source->getContents().substr(piece.offset, piece.length));
+        }
+    }
+
+    return flat;
+}
@@ -1,6 +1,10 @@
 #include "ListParser.hpp"
 
-ListParser::ListParser(std::string listPath) {
+#include <charconv>
+
+#include "ItemSorter.hpp"
+
+ListParser::ListParser(std::string listPath) : atStartOfFile(true) {
     try {
         fproc = new FileProcessor(listPath);
     } catch(InvalidFileException& e) {
@@ -8,26 +12,139 @@ ListParser::ListParser(std::string listPath) {
     }
 }
 
+ListParser::ListParser(std::shared_ptr<MappedFile> file, std::string_view chunk, bool atStartOfFileIn) :
+    atStartOfFile(atStartOfFileIn) {
+    fproc = new FileProcessor(file, chunk);
+}
+
 ListParser::~ListParser() {
     delete fproc;
 }
 
 std::vector<Section> ListParser::parseList() {
+    unsigned numThreads = std::thread::hardware_concurrency();
+    size_t size = fproc->getFile()->getSize();
+    if(size >= PARALLEL_PARSE_THRESHOLD && numThreads > 1) {
+        return parseListInParallel(numThreads);
+    }
+
+    return parseSections(false);
+}
+
+std::vector<Section> ListParser::parseList(unsigned numThreads) {
+    if(numThreads > 1) {
+        return parseListInParallel(numThreads);
+    }
+
+    return parseSections(false);
+}
+
+std::vector<Section> ListParser::parseListInParallel(unsigned numThreads) {
+    std::shared_ptr<MappedFile> file = fproc->getFile();
+    std::vector<std::string_view> chunks = splitIntoChunks(file->getContents(), numThreads * CHUNKS_PER_THREAD);
+    int numChunks = (int)chunks.size();
+
+    std::vector<std::vector<Section>> chunkSections(numChunks);
+    std::vector<std::vector<std::string_view>> chunkBlocks(numChunks);
+    std::vector<const char *> chunkErrors(numChunks, nullptr);
+    std::atomic<int> nextChunk(0);
+
+    // Each worker keeps claiming the next unparsed chunk until none are left
+    auto parseChunks = [&]() {
+        int i;
+        while((i = nextChunk++) < numChunks) {
+            ListParser chunkParser(file, chunks[i], i == 0);
+            try {
+                chunkSections[i] = chunkParser.parseSections(false);
+                chunkBlocks[i] = chunkParser.getBlocks();
+            } catch(InvalidFileException& e) {
+                chunkErrors[i] = e.what();
+            }
+        }
+    };
+
+    int numWorkers = std::min((int)numThreads, numChunks) - 1;
+    std::vector<std::thread> workers;
+    for(int i = 0; i < numWorkers; i++) {
+        workers.emplace_back(parseChunks);
+    }
+    parseChunks();
+    for(std::thread & worker : workers) {
+        worker.join();
+    }
+
+    // Stitch the chunks back together in file order
+    std::vector<Section> sections;
+    for(int i = 0; i < numChunks; i++) {
+        if(chunkErrors[i] != nullptr) {
+            // Report the same error a front-to-back parse would have hit
+            throw InvalidFileException(chunkErrors[i]);
+        }
+
+        for(Section & section : chunkSections[i]) {
+            sections.push_back(std::move(section));
+        }
+        blocks.insert(blocks.end(), chunkBlocks[i].begin(), chunkBlocks[i].end());
+    }
+
+    return sections;
+}
+
+std::vector<std::string_view> ListParser::splitIntoChunks(std::string_view contents, unsigned numChunks) {
+    // Blank lines always end a section, so it is safe to cut right after one
+    std::vector<std::string_view> chunks;
+    size_t target = std::max<size_t>(contents.size() / numChunks, 1);
+    size_t begin = 0;
+    while(begin < contents.size()) {
+        size_t end = begin + target;
+        if(end >= contents.size()) {
+            end = contents.size();
+        } else {
+            size_t blankLine = LineScanner::findBlankLine(contents, end);
+            end = (blankLine == std::string_view::npos) ? contents.size() : blankLine + 2;
+        }
+
+        chunks.push_back(contents.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return chunks;
+}
+
+std::vector<Section> ListParser::parseListLazily() {
+    // Only headers are parsed, items stay in the mapping until needed
+    return parseSections(true);
+}
+
+std::vector<Section> ListParser::parseSections(bool lazily) {
     std::vector<Section> sections;
 
     bool fileIsEmpty = true;
-    bool firstLine = true;
-    std::string line;
+    bool firstLine = atStartOfFile;
+    std::string_view line;
     while(!(fproc->isEOF)) {
         fileIsEmpty = false;
+        if(!firstLine) {
+            // Lines between sections that are not headers are ignored
+            fproc->skipToSectionHeader();
+            if(fproc->isEOF) { break; }
+        }
+
         line = fproc->poll();
         if(isSectionTitle(line) || firstLine) {
             firstLine = false;
             try {
                 std::string sectionTitle = extractSectionTitle(line);
                 int sectionColorCode = extractColorCode(line);
-                Section section = parseSection(sectionTitle, sectionColorCode);
-                sections.push_back(section);
+                SortOrder sectionSortOrder = extractSortOrder(line);
+                if(lazily) {
+                    std::string_view block = fproc->pollBlock();
+                    sections.emplace_back(sectionTitle, sectionColorCode, fproc->getFile(), block);
+                    blocks.push_back(block);
+                } else {
+                    sections.push_back(parseSection(sectionTitle, sectionColorCode));
+                }
+                sections.back().sortOrder = sectionSortOrder;
             } catch(InvalidFileException& e) {
                 throw InvalidFileException(e.what());
             }
@@ -42,45 +159,50 @@ std::vector<Section> ListParser::parseList() {
     return sections;
 }
 
-bool ListParser::isSectionTitle(std::string line) {
+bool ListParser::isSectionTitle(std::string_view line) {
     // Section titles are of the format [Section Title] : ColorCode
-    std::string firstChar = line.substr(0, 1);
-    
-    return firstChar == "[";
+    return !line.empty() && line[0] == '[';
 }
 
-std::string ListParser::extractSectionTitle(std::string line) {
+std::string ListParser::extractSectionTitle(std::string_view line) {
     size_t closingBrace = line.find(']');
-    if(closingBrace == std::string::npos) {
+    if(closingBrace == std::string_view::npos) {
         const char * message = "Section titles must be enclosed in braces (e.g. [Section Title]).";
         throw InvalidFileException(message);
     }
 
-    std::string title = line.substr(1, closingBrace - 1);
+    std::string title(line.substr(1, closingBrace - 1));
 
     return title;
 }
 
-int ListParser::extractColorCode(std::string line) {
+int ListParser::extractColorCode(std::string_view line) {
     // Remove title portion first, then check for colon and integer
     size_t closingBrace = line.find(']');
     line = line.substr(closingBrace);
 
     size_t colon = line.find_last_of(':');
-    if(colon == std::string::npos) {
+    if(colon == std::string_view::npos) {
         const char * message = "Section lines must have a colon (:) between the title and color code.";
         throw InvalidFileException(message);
     }
 
-    std::string codeStr = line.substr(colon + 1);
-    std::string trimStr = trimWhitespace(codeStr);
+    std::string_view codeStr = trimWhitespace(line.substr(colon + 1));
+
+    // Accept the same leading whitespace and sign that stoi() would
+    while(!codeStr.empty() && isspace((unsigned char)codeStr.front())) {
+        codeStr.remove_prefix(1);
+    }
+    if(!codeStr.empty() && codeStr.front() == '+') {
+        codeStr.remove_prefix(1);
+    }
+
     int code;
-    try {
-        code = stoi(trimStr);
-    } catch(std::invalid_argument& e) {
+    std::from_chars_result result = std::from_chars(codeStr.data(), codeStr.data() + codeStr.size(), code);
+    if(result.ec == std::errc::invalid_argument) {
         const char * message = "Color code must be an integer.";
         throw InvalidFileException(message);
-    } catch(std::out_of_range& e) {
+    } else if(result.ec == std::errc::result_out_of_range) {
         const char * message = "Color code cannot be an exceedingly large number.";
         throw InvalidFileException(message);
     }
@@ -88,9 +210,9 @@ int ListParser::extractColorCode(std::string line) {
     return code;
 }
 
-std::string ListParser::trimWhitespace(std::string str) {
+std::string_view ListParser::trimWhitespace(std::string_view str) {
 	size_t first = str.find_first_not_of(' ');
-	if(std::string::npos == first) {
+	if(std::string_view::npos == first) {
 		return str;
 	}
 
@@ -101,19 +223,62 @@ std::string ListParser::trimWhitespace(std::string str) {
 
 Section ListParser::parseSection(std::string sectionTitle, int sectionColorCode) {
     Section section(sectionTitle, sectionColorCode);
-    std::string line;
+    std::string_view line;
+    std::string_view first;
+    std::string_view last;
     while(!(fproc->isEOF)) {
         line = fproc->poll();
         if(isEndOfSection(line)) {
             break;
         }
 
-        section.addItem(line);
+        section.loadItem(line);
+        if(first.empty()) {
+            first = line;
+        }
+        last = line;
+    }
+
+    // Remember the span of the file the items came from, for the index and
+    // so that saves can copy the section as it is until it changes
+    std::string_view block;
+    if(!first.empty()) {
+        size_t length = (last.data() + last.size()) - first.data();
+        block = std::string_view(first.data(), length);
     }
+    blocks.push_back(block);
+    section.attachOrigin(fproc->getFile(), block);
 
     return section;
 }
 
-bool ListParser::isEndOfSection(std::string line) {
-    return line == "";
+bool ListParser::isEndOfSection(std::string_view line) {
+    return line.empty();
+}
+
+std::vector<std::string_view> ListParser::getBlocks() {
+    return blocks;
+}
+
+std::shared_ptr<MappedFile> ListParser::getFile() {
+    return fproc->getFile();
+}
+
+SortOrder ListParser::extractSortOrder(std::string_view line) {
+    // An optional "sort=<order>" after the color code. Orders this version
+    // doesn't know leave the section unsorted rather than failing the load.
+    static const std::string_view marker = "sort=";
+    size_t closingBrace = line.find(']');
+    size_t found = line.find(marker, closingBrace);
+    if(found == std::string_view::npos) {
+        return UNSORTED;
+    }
+
+    std::string_view name = line.substr(found + marker.size());
+    size_t end = 0;
+    while(end < name.size() && !isspace((unsigned char)name[end])) {
+        end++;
+    }
+
+    return ItemSorter::getOrderFromName(name.substr(0, end));
 }
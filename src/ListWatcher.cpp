@@ -0,0 +1,102 @@
+#include "ListWatcher.hpp"
+
+#include <cstring>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ListWatcher::ListWatcher(std::string listPathIn) :
+    listPath(listPathIn), inotifyFd(-1), watchDescriptor(-1), stamp({0, 0, 0}) {
+    startWatching();
+    acknowledgeChanges();
+}
+
+ListWatcher::~ListWatcher() {
+    if(inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+}
+
+void ListWatcher::startWatching() {
+    size_t slash = listPath.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : listPath.substr(0, slash + 1);
+    listName = slash == std::string::npos ? listPath : listPath.substr(slash + 1);
+
+    // Without inotify (or with its limits used up) we just never reload
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        return;
+    }
+
+    watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watchDescriptor < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+}
+
+bool ListWatcher::listHasChanged() {
+    if(!drainEvents()) {
+        return false;
+    }
+
+    if(!stampHasChanged()) {
+        return false;
+    }
+
+    acknowledgeChanges();
+    return true;
+}
+
+bool ListWatcher::drainEvents() {
+    if(inotifyFd < 0) {
+        return false;
+    }
+
+    // Events for the rest of the directory (our index included) are dropped
+    alignas(struct inotify_event) char buffer[4096];
+    bool listTouched = false;
+    ssize_t length;
+    while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        ssize_t offset = 0;
+        while(offset < length) {
+            struct inotify_event * event = (struct inotify_event *)(buffer + offset);
+            if(event->len > 0 && listName == event->name) {
+                listTouched = true;
+            }
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return listTouched;
+}
+
+bool ListWatcher::readStamp(ListStamp & current) {
+    struct stat info;
+    if(stat(listPath.c_str(), &info) != 0) {
+        return false;
+    }
+
+    current.size = (uint64_t)info.st_size;
+    current.mtimeSec = (int64_t)info.st_mtim.tv_sec;
+    current.mtimeNsec = (int64_t)info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool ListWatcher::stampHasChanged() {
+    ListStamp current;
+    if(!readStamp(current)) {
+        return false;
+    }
+
+    return current.size != stamp.size || current.mtimeSec != stamp.mtimeSec ||
+           current.mtimeNsec != stamp.mtimeNsec;
+}
+
+void ListWatcher::acknowledgeChanges() {
+    readStamp(stamp);
+}
+
+int ListWatcher::getFd() {
+    return inotifyFd;
+}
@@ -0,0 +1,288 @@
+#include "ListWriter.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ListIndex.hpp"
+
+ListWriter::ListWriter() :
+    writing(false), finishedSave(false), finishedGeneration(0), failedSave(false),
+    journalBroken(false), stopping(false) {
+    worker = std::thread(&ListWriter::run, this);
+}
+
+ListWriter::~ListWriter() {
+    // Anything still queued is written before we let go, e.g. a save on quit
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void ListWriter::save(std::string listPath, ListLayout layout, uint64_t generation, std::string journalPath) {
+    std::unique_ptr<SaveJob> job(new SaveJob{listPath, std::move(layout), "", journalPath,
+                                             false, false, generation});
+
+    // A rewrite holds everything, so nothing queued before it matters
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.clear();
+        pending.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void ListWriter::append(std::string journalPath, std::string records, bool truncate, uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(!pending.empty() && pending.back()->append && pending.back()->path == journalPath) {
+            pending.back()->records += records;
+            pending.back()->generation = generation;
+        } else {
+            std::unique_ptr<SaveJob> job(new SaveJob{journalPath, ListLayout(), std::move(records), "",
+                                                     true, truncate, generation});
+            pending.push_back(std::move(job));
+        }
+    }
+    wake.notify_one();
+}
+
+bool ListWriter::pollCompleted(uint64_t & generation) {
+    std::lock_guard<std::mutex> guard(lock);
+    if(!finishedSave) {
+        return false;
+    }
+
+    finishedSave = false;
+    generation = finishedGeneration;
+    return true;
+}
+
+bool ListWriter::pollFailed() {
+    std::lock_guard<std::mutex> guard(lock);
+    bool failed = failedSave;
+    failedSave = false;
+
+    return failed;
+}
+
+bool ListWriter::isBusy() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    return writing || !pending.empty();
+}
+
+void ListWriter::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while(true) {
+        wake.wait(guard, [this] { return stopping || !pending.empty(); });
+        if(pending.empty()) {
+            return;
+        }
+
+        std::unique_ptr<SaveJob> job = std::move(pending.front());
+        pending.pop_front();
+        writing = true;
+        guard.unlock();
+        bool succeeded = writeJob(*job);
+        guard.lock();
+        finishJob(*job, succeeded);
+        writing = false;
+    }
+}
+
+bool ListWriter::writeJob(SaveJob & job) {
+    if(job.append) {
+        // journalBroken is only touched on this thread
+        return !journalBroken && appendDurably(job.path, job.records, job.truncate);
+    }
+
+    if(!writeDurably(job.path, job.layout)) {
+        return false;
+    }
+
+    if(job.journalPath != "") {
+        remove(job.journalPath.c_str());
+    }
+    if(ListIndex::cacheEnabled()) {
+        writeIndex(job.path, job.layout);
+    }
+
+    return true;
+}
+
+void ListWriter::finishJob(SaveJob & job, bool succeeded) {
+    // A failure is only flagged for pollFailed(), the changes stay unsaved
+    if(!succeeded) {
+        failedSave = true;
+        journalBroken = journalBroken || job.append;
+        return;
+    }
+
+    if(!job.append) {
+        journalBroken = false;
+    }
+    finishedSave = true;
+    finishedGeneration = job.generation;
+}
+
+bool ListWriter::writeDurably(std::string listPath, ListLayout & layout) {
+    // Write through a symlinked list rather than replacing the link
+    std::string realPath = resolvePath(listPath);
+    std::string tempPath = realPath + ".tmp";
+
+    mode_t mode = 0644;
+    struct stat info;
+    if(stat(realPath.c_str(), &info) == 0) {
+        mode = info.st_mode & 07777;
+    }
+
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if(fd < 0) {
+        return false;
+    }
+
+    if(!writeLayout(fd, layout)) {
+        close(fd);
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    if(fsync(fd) != 0 || close(fd) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    if(rename(tempPath.c_str(), realPath.c_str()) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    syncDirectory(realPath);
+    return true;
+}
+
+bool ListWriter::appendDurably(std::string journalPath, std::string & records, bool truncate) {
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    int fd = open(journalPath.c_str(), flags, 0644);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool written = writeAll(fd, records) && fdatasync(fd) == 0;
+    if(close(fd) != 0) {
+        written = false;
+    }
+
+    // A brand new journal is only durable once its directory entry is
+    if(written && truncate) {
+        syncDirectory(journalPath);
+    }
+
+    return written;
+}
+
+bool ListWriter::writeLayout(int fd, ListLayout & layout) {
+    std::string_view text = layout.text;
+    for(ListLayout::Piece & piece : layout.pieces) {
+        bool written;
+        if(piece.source == nullptr) {
+            written = writeAll(fd, text.substr(piece.offset, piece.length));
+        } else {
+            written = copyRange(fd, *piece.source, piece.offset, piece.length);
+        }
+
+        if(!written) { return false; }
+    }
+
+    return true;
+}
+
+bool ListWriter::copyRange(int fd, MappedFile & source, uint64_t offset, uint64_t length) {
+    // Let the kernel move unchanged sections over (or share their blocks, on
+    // filesystems that can), falling back to writing them from the mapping
+    loff_t sourceOffset = (loff_t)offset;
+    uint64_t remaining = length;
+    while(remaining > 0) {
+        ssize_t copied = copy_file_range(source.getFd(), &sourceOffset, fd, nullptr, remaining, 0);
+        if(copied <= 0) {
+            if(copied < 0 && errno == EINTR) { continue; }
+            break;
+        }
+        remaining -= (uint64_t)copied;
+    }
+
+    if(remaining == 0) {
+        return true;
+    }
+
+    uint64_t done = length - remaining;
+    return writeAll(fd, source.getContents().substr(offset + done, remaining));
+}
+
+void ListWriter::writeIndex(std::string listPath, ListLayout & layout) {
+    // Item offsets and the checksum come from the file as it landed
+    std::shared_ptr<MappedFile> written;
+    try {
+        written = std::make_shared<MappedFile>(listPath);
+    } catch(InvalidFileException& e) {
+        return;
+    }
+
+    std::string_view contents = written->getContents();
+    if(contents.size() != layout.size) {
+        return;
+    }
+
+    ListIndex index(listPath);
+    for(ListLayout::SectionSpan & span : layout.sections) {
+        index.addSection(span.title, span.colorCode, span.sortOrder, contents,
+                         contents.substr(span.blockOffset, span.blockLength));
+    }
+    index.setChecksum(contents);
+    index.save();
+}
+
+bool ListWriter::writeAll(int fd, std::string_view contents) {
+    const char * data = contents.data();
+    size_t remaining = contents.size();
+    while(remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if(written < 0) {
+            if(errno == EINTR) { continue; }
+            return false;
+        }
+        data += written;
+        remaining -= (size_t)written;
+    }
+
+    return true;
+}
+
+std::string ListWriter::resolvePath(std::string path) {
+    char resolved[PATH_MAX];
+    if(realpath(path.c_str(), resolved) == nullptr) {
+        return path;
+    }
+
+    return std::string(resolved);
+}
+
+void ListWriter::syncDirectory(std::string path) {
+    // The rename itself is only durable once the directory is on disk
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
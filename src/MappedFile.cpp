@@ -0,0 +1,82 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(std::string pathIn) :
+	path(pathIn), fd(-1), data(nullptr), size(0), mtimeSec(0), mtimeNsec(0) {
+	fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		const char * message = "File does not exist.";
+		throw InvalidFileException(message);
+	}
+
+	try {
+		mapFile();
+	} catch(InvalidFileException& e) {
+		close(fd);
+		throw InvalidFileException(e.what());
+	}
+}
+
+MappedFile::~MappedFile() {
+	unmapFile();
+	close(fd);
+}
+
+void MappedFile::mapFile() {
+	struct stat info;
+	if(fstat(fd, &info) != 0) {
+		const char * message = "Could not read file information.";
+		throw InvalidFileException(message);
+	}
+
+	size = (size_t)info.st_size;
+	mtimeSec = (int64_t)info.st_mtim.tv_sec;
+	mtimeNsec = (int64_t)info.st_mtim.tv_nsec;
+	if(size == 0) {
+		// mmap() refuses zero-length mappings, so empty files map to nothing
+		return;
+	}
+
+	void * mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(mapping == MAP_FAILED) {
+		const char * message = "Could not map file into memory.";
+		throw InvalidFileException(message);
+	}
+
+	// We read the whole file front to back, so tell the kernel to read ahead
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = (const char *)mapping;
+}
+
+void MappedFile::unmapFile() {
+	if(data != nullptr) {
+		munmap((void *)data, size);
+		data = nullptr;
+	}
+}
+
+std::string_view MappedFile::getContents() {
+	return std::string_view(data, size);
+}
+
+size_t MappedFile::getSize() {
+	return size;
+}
+
+int MappedFile::getFd() {
+	return fd;
+}
+
+bool MappedFile::isUnchangedOnDisk() {
+	struct stat info;
+	if(fstat(fd, &info) != 0) {
+		return false;
+	}
+
+	return (size_t)info.st_size == size && (int64_t)info.st_mtim.tv_sec == mtimeSec &&
+	       (int64_t)info.st_mtim.tv_nsec == mtimeNsec;
+}
@@ -0,0 +1,29 @@
+#include "SearchForm.hpp"
+
+SearchForm::SearchForm(State * state) : DialogForm("Search:", state) {}
+
+void SearchForm::inputChanged() {
+    std::string query = SearchIndex::lowercase(buffer);
+
+    // Short queries would match nearly everything, and can't use the index,
+    // so they are only run once submitted
+    if(query.size() < SEARCH_MIN_INDEXED_QUERY) {
+        state->clearSearch();
+        lastQuery.clear();
+        redrawPanels();
+        return;
+    }
+
+    Document * document = state->getDocument();
+    std::vector<uint64_t> matches;
+    if(!lastQuery.empty() && query.compare(0, lastQuery.size(), lastQuery) == 0) {
+        matches = state->getSearchIndex()->refine(lastMatches, query);
+    } else {
+        matches = state->getSearchIndex()->find(document, query);
+    }
+
+    state->showSearchResults(query, matches);
+    lastQuery = query;
+    lastMatches = std::move(matches);
+    redrawPanels();
+}
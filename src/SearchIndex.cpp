@@ -0,0 +1,333 @@
+#include "SearchIndex.hpp"
+
+#include <algorithm>
+
+#include "Hash.hpp"
+
+static char lowerByte(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+}
+
+SearchIndex::SearchIndex() {}
+
+SearchIndex::~SearchIndex() {
+    stopBuild();
+}
+
+void SearchIndex::build(Document * document) {
+    stopBuild();
+    startBuild(document);
+}
+
+void SearchIndex::startBuild(Document * document) {
+    size_t numItems = tracker.prepareBuild(document);
+    built = std::make_unique<Tables>();
+    built->ids.reserve(numItems);
+    built->texts.reserve(numItems);
+    built->docs.reserve(numItems);
+    tracker.startBuild([this]() { runBuild(); });
+}
+
+void SearchIndex::runBuild() {
+    Tables & into = *built;
+    tracker.visitBuildItems([&](Section * section, uint64_t id, std::string_view text) {
+        addDoc(into, id, text, hashBytes(text));
+    });
+}
+
+void SearchIndex::finishBuild(Document * document) {
+    tracker.finishBuild(document);
+    tables = std::move(built);
+
+    // Edits made while the build ran are still to be read
+    sync(document);
+}
+
+void SearchIndex::stopBuild() {
+    tracker.stopBuild();
+    built.reset();
+}
+
+void SearchIndex::sync(Document * document) {
+    if(tracker.hasFinishedBuild()) {
+        finishBuild(document);
+        return;
+    }
+    if(tracker.isBuilding() || tables == nullptr) { return; }
+
+    Tables & t = *tables;
+    t.stamp++;
+    tracker.catchUp(document, [&](Section * section, uint64_t id, std::string_view text, int index) {
+        uint64_t textHash = hashBytes(text);
+        auto doc = t.docs.find(id);
+        if(doc != t.docs.end() && doc->second.textHash == textHash) {
+            // Still the same, but read it from where it lives now
+            doc->second.stamp = t.stamp;
+            t.texts[doc->second.number] = text;
+            return;
+        }
+        if(doc != t.docs.end()) {
+            removeDoc(t, id);
+        }
+        addDoc(t, id, text, textHash);
+    }, [&](uint64_t id) {
+        auto doc = t.docs.find(id);
+        if(doc != t.docs.end() && doc->second.stamp != t.stamp) {
+            removeDoc(t, id);
+        }
+    });
+
+    if(t.deadDocs > SEARCH_MIN_STALE_ITEMS && t.deadDocs > t.docs.size()) {
+        startBuild(document);
+    }
+}
+
+std::vector<uint64_t> SearchIndex::find(Document * document, std::string_view query) {
+    std::string lowered = lowercase(query);
+    if(tracker.isBuilding()) {
+        finishBuild(document);
+    } else {
+        sync(document);
+    }
+
+    if(lowered.size() < SEARCH_MIN_INDEXED_QUERY || tables == nullptr) {
+        return scanAll(document, lowered);
+    }
+
+    std::vector<uint32_t> trigrams;
+    collectTrigrams(lowered, trigrams);
+
+    std::vector<const Posting *> postings;
+    for(uint32_t trigram : trigrams) {
+        const Posting * posting = findPosting(*tables, trigram, false);
+        if(posting == nullptr) {
+            return std::vector<uint64_t>();
+        }
+        postings.push_back(posting);
+    }
+
+    // Start from the rarest trigram so the candidate list is short from the
+    // start, and every other list only has to be walked once
+    std::sort(postings.begin(), postings.end(), [](const Posting * a, const Posting * b) {
+        return a->count < b->count;
+    });
+    std::vector<uint32_t> candidates = decodePosting(*postings[0]);
+    for(size_t i = 1; i < postings.size() && !candidates.empty(); i++) {
+        candidates = intersectPosting(candidates, *postings[i]);
+    }
+
+    // A single trigram needs no checking, anything longer could have its
+    // trigrams in the wrong order
+    bool exact = lowered.size() == SEARCH_MIN_INDEXED_QUERY;
+    std::vector<uint64_t> matches;
+    for(uint32_t number : candidates) {
+        uint64_t id = tables->ids[number];
+        if(id == 0) { continue; }
+        if(exact || findIgnoringCase(tables->texts[number], lowered) != std::string_view::npos) {
+            matches.push_back(id);
+        }
+    }
+
+    return matches;
+}
+
+std::vector<uint64_t> SearchIndex::refine(std::vector<uint64_t> & previous, std::string_view query) {
+    std::string lowered = lowercase(query);
+    if(tables == nullptr || tracker.isBuilding()) {
+        return previous;
+    }
+
+    std::vector<uint64_t> matches;
+    for(uint64_t id : previous) {
+        auto doc = tables->docs.find(id);
+        if(doc != tables->docs.end() &&
+           findIgnoringCase(tables->texts[doc->second.number], lowered) != std::string_view::npos) {
+            matches.push_back(id);
+        }
+    }
+
+    return matches;
+}
+
+std::vector<uint64_t> SearchIndex::scanAll(Document * document, std::string_view query) {
+    std::vector<uint64_t> matches;
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        document->getSection(i)->visitItemsNotIn(nullptr, [&](uint64_t id, std::string_view text, int) {
+            if(findIgnoringCase(text, query) != std::string_view::npos) {
+                matches.push_back(id);
+            }
+        });
+    }
+
+    return matches;
+}
+
+void SearchIndex::addDoc(Tables & into, uint64_t id, std::string_view text, uint64_t textHash) {
+    uint32_t number = (uint32_t)into.ids.size();
+    into.ids.push_back(id);
+    into.texts.push_back(text);
+    into.docs[id] = Doc{number, into.stamp, textHash};
+
+    thread_local std::vector<uint32_t> trigrams;
+    collectTrigrams(text, trigrams);
+    for(uint32_t trigram : trigrams) {
+        appendPosting(*findPosting(into, trigram, true), number);
+    }
+}
+
+void SearchIndex::removeDoc(Tables & from, uint64_t id) {
+    auto doc = from.docs.find(id);
+    if(doc == from.docs.end()) { return; }
+
+    from.ids[doc->second.number] = 0;
+    from.docs.erase(doc);
+    from.deadDocs++;
+}
+
+SearchIndex::Posting * SearchIndex::findPosting(Tables & in, uint32_t trigram, bool create) {
+    if(in.slots.empty()) {
+        if(!create) { return nullptr; }
+        growSlots(in);
+    }
+
+    size_t mask = in.slots.size() - 1;
+    size_t slot = (trigram * 0x9e3779b1u) & mask;
+    while(in.slots[slot].posting != UINT32_MAX) {
+        if(in.slots[slot].trigram == trigram) {
+            return &in.postings[in.slots[slot].posting];
+        }
+        slot = (slot + 1) & mask;
+    }
+    if(!create) { return nullptr; }
+
+    in.slots[slot] = Slot{trigram, (uint32_t)in.postings.size()};
+    in.postings.push_back(Posting{std::vector<uint8_t>(), trigram, 0, 0});
+    if(in.postings.size() * 2 > in.slots.size()) {
+        growSlots(in);
+    }
+
+    return &in.postings.back();
+}
+
+void SearchIndex::growSlots(Tables & in) {
+    size_t size = in.slots.empty() ? 4096 : in.slots.size() * 2;
+    in.slots.assign(size, Slot{0, UINT32_MAX});
+
+    size_t mask = size - 1;
+    uint32_t numPostings = (uint32_t)in.postings.size();
+    for(uint32_t posting = 0; posting < numPostings; posting++) {
+        uint32_t trigram = in.postings[posting].trigram;
+        size_t slot = (trigram * 0x9e3779b1u) & mask;
+        while(in.slots[slot].posting != UINT32_MAX) {
+            slot = (slot + 1) & mask;
+        }
+        in.slots[slot] = Slot{trigram, posting};
+    }
+}
+
+void SearchIndex::appendPosting(Posting & posting, uint32_t number) {
+    uint32_t delta = posting.count == 0 ? number : number - posting.last;
+    while(delta >= 0x80) {
+        posting.deltas.push_back((uint8_t)(delta | 0x80));
+        delta >>= 7;
+    }
+    posting.deltas.push_back((uint8_t)delta);
+
+    posting.last = number;
+    posting.count++;
+}
+
+std::vector<uint32_t> SearchIndex::decodePosting(const Posting & posting) {
+    std::vector<uint32_t> numbers;
+    numbers.reserve(posting.count);
+
+    uint32_t number = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for(uint8_t byte : posting.deltas) {
+        delta |= (uint32_t)(byte & 0x7f) << shift;
+        if(byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+
+        number += delta;
+        numbers.push_back(number);
+        delta = 0;
+        shift = 0;
+    }
+
+    return numbers;
+}
+
+std::vector<uint32_t> SearchIndex::intersectPosting(const std::vector<uint32_t> & candidates,
+                                                    const Posting & posting) {
+    // Both are ascending, so walk them together
+    std::vector<uint32_t> kept;
+    size_t next = 0;
+    uint32_t number = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for(uint8_t byte : posting.deltas) {
+        delta |= (uint32_t)(byte & 0x7f) << shift;
+        if(byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+
+        number += delta;
+        delta = 0;
+        shift = 0;
+        while(next < candidates.size() && candidates[next] < number) {
+            next++;
+        }
+        if(next == candidates.size()) { break; }
+        if(candidates[next] == number) {
+            kept.push_back(number);
+            next++;
+        }
+    }
+
+    return kept;
+}
+
+void SearchIndex::collectTrigrams(std::string_view text, std::vector<uint32_t> & trigrams) {
+    trigrams.clear();
+    for(size_t i = 0; i + 3 <= text.size(); i++) {
+        uint32_t trigram = ((uint32_t)(uint8_t)lowerByte(text[i]) << 16) |
+                           ((uint32_t)(uint8_t)lowerByte(text[i + 1]) << 8) |
+                           (uint32_t)(uint8_t)lowerByte(text[i + 2]);
+        trigrams.push_back(trigram);
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+std::string SearchIndex::lowercase(std::string_view text) {
+    std::string lowered(text);
+    for(char & ch : lowered) {
+        ch = lowerByte(ch);
+    }
+
+    return lowered;
+}
+
+size_t SearchIndex::findIgnoringCase(std::string_view text, std::string_view loweredQuery) {
+    if(loweredQuery.empty()) { return 0; }
+    if(loweredQuery.size() > text.size()) { return std::string_view::npos; }
+
+    size_t last = text.size() - loweredQuery.size();
+    for(size_t i = 0; i <= last; i++) {
+        size_t matched = 0;
+        while(matched < loweredQuery.size() && lowerByte(text[i + matched]) == loweredQuery[matched]) {
+            matched++;
+        }
+        if(matched == loweredQuery.size()) {
+            return i;
+        }
+    }
+
+    return std::string_view::npos;
+}
@@ -0,0 +1,657 @@
+#include "Section.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <random>
+
+#include "Config.hpp"
+#include "Hash.hpp"
+#include "ItemSorter.hpp"
+
+static const size_t ITEM_ID_MARKER_LENGTH = sizeof(ITEM_ID_MARKER) - 1;
+
+// How many IDs a thread takes from the shared counter at a time
+#define ITEM_ID_BATCH 1024
+
+// IDs are a random starting point plus a counter, scrambled so IDs from
+// different runs land far apart. The parser picks IDs from several threads,
+// which take them in batches so they don't fight over the counter.
+static uint64_t newItemId() {
+    static const uint64_t seed = ((uint64_t)std::random_device()() << 32) ^ std::random_device()() ^
+        (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    static std::atomic<uint64_t> counter(0);
+    thread_local uint64_t next = 0;
+    thread_local uint64_t batchEnd = 0;
+
+    if(next == batchEnd) {
+        next = counter.fetch_add(ITEM_ID_BATCH, std::memory_order_relaxed);
+        batchEnd = next + ITEM_ID_BATCH;
+    }
+
+    uint64_t id = seed + (next++) * 0x9e3779b97f4a7c15ULL;
+    id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    id = (id ^ (id >> 27)) * 0x94d049bb133111ebULL;
+    id = id ^ (id >> 31);
+
+    return id == 0 ? 1 : id;
+}
+
+// Splits a saved ID off the end of a line, or picks a new one
+static std::string_view splitItemId(std::string_view line, uint64_t & id) {
+    size_t longest = ITEM_ID_MARKER_LENGTH + 16;
+    size_t from = line.size() > longest ? line.size() - longest : 0;
+    size_t marker = line.find('\t', from);
+    if(marker != std::string_view::npos && line.substr(marker, ITEM_ID_MARKER_LENGTH) == ITEM_ID_MARKER) {
+        const char * digits = line.data() + marker + ITEM_ID_MARKER_LENGTH;
+        const char * end = line.data() + line.size();
+        auto result = std::from_chars(digits, end, id, 16);
+        if(digits != end && result.ec == std::errc() && result.ptr == end && id != 0) {
+            return line.substr(0, marker);
+        }
+    }
+
+    id = newItemId();
+    return line;
+}
+
+Section::Section(std::string titleIn, int colorCodeIn) :
+    title(titleIn), colorCode(colorCodeIn), sortOrder(UNSORTED), itemIndex(nullptr) {
+    contents = std::make_shared<Contents>();
+    contents->dirty = true;
+    contents->fingerprint = 0;
+    contents->fingerprintValid = false;
+    contents->blockIdsChecked = false;
+    contents->blockHasIds = false;
+}
+
+Section::Section(std::string titleIn, int colorCodeIn,
+                 std::shared_ptr<MappedFile> sourceIn, std::string_view blockIn) :
+    title(titleIn), colorCode(colorCodeIn), sortOrder(UNSORTED), itemIndex(nullptr) {
+    contents = std::make_shared<Contents>();
+    contents->source = sourceIn;
+    contents->pending = blockIn;
+    contents->origin = sourceIn;
+    contents->originalBlock = blockIn;
+    contents->dirty = false;
+    contents->fingerprint = 0;
+    contents->fingerprintValid = false;
+    contents->blockIdsChecked = false;
+    contents->blockHasIds = false;
+}
+
+Section::Section(const Section & other) :
+    title(other.title), colorCode(other.colorCode), sortOrder(other.sortOrder), contents(other.contents),
+    itemIndex(nullptr) {}
+
+Section::Section(Section && other) noexcept :
+    title(std::move(other.title)), colorCode(other.colorCode), sortOrder(other.sortOrder),
+    contents(std::move(other.contents)), itemIndex(nullptr) {}
+
+Section & Section::operator=(const Section & other) {
+    if(this == &other) { return *this; }
+
+    unregisterItems();
+    title = other.title;
+    colorCode = other.colorCode;
+    sortOrder = other.sortOrder;
+    contents = other.contents;
+    registerItems();
+
+    return *this;
+}
+
+Section & Section::operator=(Section && other) {
+    if(this == &other) { return *this; }
+
+    unregisterItems();
+    title = std::move(other.title);
+    colorCode = other.colorCode;
+    sortOrder = other.sortOrder;
+    contents = std::move(other.contents);
+    registerItems();
+
+    return *this;
+}
+
+bool Section::itemIdsPersisted() {
+    std::string persistStr = Config::getInstance().getValueFromKey("PersistItemIds");
+
+    return persistStr == "true";
+}
+
+std::string Section::formatItemId(uint64_t id) {
+    char digits[17];
+    snprintf(digits, sizeof(digits), "%016llx", (unsigned long long)id);
+
+    return std::string(ITEM_ID_MARKER) + digits;
+}
+
+void Section::addItem(std::string_view itemIn) {
+    addItem(itemIn, newItemId());
+}
+
+void Section::addItem(std::string_view itemIn, uint64_t id) {
+    beginChange();
+    pushItem(itemArena().intern(itemIn), id);
+}
+
+void Section::loadItem(std::string_view itemIn) {
+    beginChange();
+    uint64_t id;
+    std::string_view text = splitItemId(itemIn, id);
+    pushItem(itemArena().store(text), id);
+}
+
+std::string_view Section::getItem(int index) {
+    indexThrough(index);
+    return contents->items[index].text.view();
+}
+
+uint64_t Section::getItemId(int index) {
+    indexThrough(index);
+    return contents->items[index].id;
+}
+
+int Section::findItemById(uint64_t id, int hint, int radius) {
+    // A hint past the end (the section shrank) counts from the last item
+    int end = countItemsUpTo(hint + radius + 1);
+    hint = std::max(std::min(hint, end - 1), 0);
+
+    // Ids are unique, so each window is walked in order, a chunk at a time.
+    // Windows start small and widen, since most items haven't gone far.
+    int reach = std::min(radius, 16);
+    while(true) {
+        int first = std::max(hint - reach, 0);
+        int last = std::min(hint + reach, end - 1);
+        int found = -1;
+        int index = first;
+        contents->items.visitFrom(first, [&](const Entry & entry) {
+            if(entry.id == id) {
+                found = index;
+            }
+            return found < 0 && ++index <= last;
+        });
+
+        if(found >= 0 || reach == radius) {
+            return found;
+        }
+        reach = std::min(radius, reach * 8);
+    }
+}
+
+void Section::setItem(int index, std::string_view item) {
+    beginChange();
+    Entry entry = contents->items[index];
+    entry.text = itemArena().intern(item);
+    contents->items.set(index, entry);
+    contents->metadata.set(index, item);
+}
+
+void Section::insertItem(int index, std::string_view item) {
+    insertItem(index, item, newItemId());
+}
+
+void Section::insertItem(int index, std::string_view item, uint64_t id) {
+    beginChange();
+    contents->items.insert(index, Entry{itemArena().intern(item), id});
+    contents->metadata.insert(index, item);
+    if(itemIndex != nullptr) {
+        itemIndex->add(id, this, index);
+    }
+}
+
+void Section::eraseItem(int index) {
+    beginChange();
+    if(itemIndex != nullptr) {
+        itemIndex->remove(contents->items[index].id);
+    }
+    contents->items.erase(index);
+    contents->metadata.erase(index);
+}
+
+void Section::swapItems(int a, int b) {
+    beginChange();
+    contents->items.swap(a, b);
+    if(std::max(a, b) < (int)contents->metadata.size()) {
+        contents->metadata.swap(a, b);
+    } else {
+        contents->metadata.set(a, contents->items[a].text.view());
+        contents->metadata.set(b, contents->items[b].text.view());
+    }
+    if(itemIndex != nullptr) {
+        itemIndex->add(contents->items[a].id, this, a);
+        itemIndex->add(contents->items[b].id, this, b);
+    }
+}
+
+std::vector<int> Section::sortItems(SortOrder order) {
+    std::vector<int> positions = ItemSorter::sortedPositions(*this, order);
+    int numItems = (int)positions.size();
+    bool moved = false;
+    for(int i = 0; i < numItems && !moved; i++) {
+        moved = positions[i] != i;
+    }
+    if(!moved) {
+        return positions;
+    }
+
+    beginChange();
+    std::vector<Entry> entries;
+    entries.reserve(numItems);
+    contents->items.visitFrom(0, [&](const Entry & entry) {
+        entries.push_back(entry);
+        return true;
+    });
+
+    ChunkedSequence<Entry> sorted;
+    for(int position : positions) {
+        sorted.push_back(entries[position]);
+    }
+    contents->items = std::move(sorted);
+    contents->metadata.reorder(positions);
+    registerItems();
+
+    return positions;
+}
+
+int Section::keepItemInOrder(int index) {
+    if(sortOrder == UNSORTED) {
+        return index;
+    }
+
+    // Most edits leave the item between the same neighbours
+    bool afterPrevious = index == 0 || ItemSorter::compareItemsAt(*this, index - 1, index, sortOrder) <= 0;
+    bool beforeNext = !hasItemAt(index + 1) || ItemSorter::compareItemsAt(*this, index, index + 1, sortOrder) <= 0;
+    if(afterPrevious && beforeNext) {
+        return index;
+    }
+
+    int position = ItemSorter::findInsertPosition(*this, sortOrder, index);
+    beginChange();
+    Entry entry = contents->items[index];
+    contents->items.erase(index);
+    contents->items.insert(position, entry);
+    contents->metadata.erase(index);
+    contents->metadata.insert(position, entry.text.view());
+    if(itemIndex != nullptr) {
+        itemIndex->add(entry.id, this, position);
+    }
+
+    return position;
+}
+
+int Section::getNumItems() {
+    indexAll();
+    return (int)contents->items.size();
+}
+
+bool Section::hasItemAt(int index) {
+    if(index < 0) { return false; }
+
+    indexThrough(index);
+    return index < (int)contents->items.size();
+}
+
+int Section::getDueDate(int index) {
+    describeThrough(index);
+    return contents->metadata.getDueDate(index);
+}
+
+int Section::getPriority(int index) {
+    describeThrough(index);
+    return contents->metadata.getPriority(index);
+}
+
+const ItemToken * Section::getItemTokens(int index, int & numTokens) {
+    describeThrough(index);
+    return contents->metadata.getTokens(index, numTokens);
+}
+
+bool Section::itemHasTag(int index, std::string_view tag) {
+    describeThrough(index);
+    return contents->metadata.hasTag(index, contents->items[index].text.view(), tag);
+}
+
+const ItemMetadata & Section::getMetadata() {
+    describeThrough(INT_MAX - 1);
+    return contents->metadata;
+}
+
+void Section::describeInto(ItemMetadata & rows) {
+    // Copies never change shared chunks in place, so reading them is safe
+    contents->items.visitFrom(rows.size(), [&](const Entry & entry) {
+        rows.push_back(entry.text.view());
+        return true;
+    });
+}
+
+void Section::adoptMetadata(Section & copy, ItemMetadata & rows) {
+    if(contents != copy.contents || rows.size() <= contents->metadata.size()) {
+        return;
+    }
+
+    contents->metadata = std::move(rows);
+}
+
+int Section::countItemsUpTo(int limit) {
+    if(limit <= 0) { return 0; }
+
+    indexThrough(limit - 1);
+    return std::min((int)contents->items.size(), limit);
+}
+
+void Section::prefetchItems(int first, int last) {
+    // Items need no more than indexing, which is done in order, so the
+    // first item wanted doesn't matter
+    (void)first;
+    countItemsUpTo(last);
+}
+
+bool Section::isLazy() {
+    return !contents->pending.empty();
+}
+
+bool Section::sourceChangedOnDisk() {
+    return contents->source != nullptr && !contents->source->isUnchangedOnDisk();
+}
+
+bool Section::hasSameContentsAs(Section & other) {
+    if(title != other.title || colorCode != other.colorCode || sortOrder != other.sortOrder) {
+        return false;
+    }
+
+    // Copies that were never changed apart can't differ, and clean sections
+    // still read exactly as their blocks do
+    if(contents == other.contents) {
+        return true;
+    }
+    if(sourceChangedOnDisk() || other.sourceChangedOnDisk()) {
+        return false;
+    }
+    dropChangedOrigin();
+    other.dropChangedOrigin();
+    if(!contents->dirty && !other.contents->dirty && contents->origin != nullptr && other.contents->origin != nullptr) {
+        return contents->originalBlock == other.contents->originalBlock;
+    }
+
+    int numItems = getNumItems();
+    if(numItems != other.getNumItems()) {
+        return false;
+    }
+    for(int i = 0; i < numItems; i++) {
+        if(getItem(i) != other.getItem(i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Section::sharesContentsWith(Section & other) {
+    return sharesItemsWith(other) && title == other.title && colorCode == other.colorCode &&
+           sortOrder == other.sortOrder;
+}
+
+bool Section::sharesItemsWith(Section & other) {
+    return contents == other.contents;
+}
+
+void Section::attachIndex(ItemIndex * index) {
+    unregisterItems();
+    itemIndex = index;
+    registerItems();
+}
+
+void Section::detachIndex() {
+    unregisterItems();
+    itemIndex = nullptr;
+}
+
+void Section::registerItems() {
+    if(itemIndex == nullptr || !itemIndex->isActive()) { return; }
+
+    int position = 0;
+    contents->items.visitFrom(0, [&](const Entry & entry) {
+        itemIndex->add(entry.id, this, position++);
+        return true;
+    });
+}
+
+void Section::attachOrigin(std::shared_ptr<MappedFile> originIn, std::string_view blockIn) {
+    detach();
+    contents->origin = originIn;
+    contents->originalBlock = blockIn;
+    contents->dirty = false;
+    contents->fingerprintValid = false;
+    contents->blockIdsChecked = false;
+}
+
+bool Section::isDirty() {
+    return contents->dirty;
+}
+
+bool Section::cleanIfUnchanged() {
+    dropChangedOrigin();
+    if(contents->dirty && contents->origin != nullptr && itemsMatchOriginal()) {
+        contents->dirty = false;
+        contents->fingerprintValid = false;
+    }
+
+    return !contents->dirty;
+}
+
+std::shared_ptr<MappedFile> Section::getOrigin() {
+    return contents->origin;
+}
+
+std::string_view Section::getOriginalBlock() {
+    return contents->originalBlock;
+}
+
+bool Section::originalBlockHasIds() {
+    dropChangedOrigin();
+    if(contents->origin == nullptr) {
+        return false;
+    }
+    if(contents->blockIdsChecked) {
+        return contents->blockHasIds;
+    }
+
+    // Only the lines are checked, the block never changes so once is enough
+    bool hasIds = true;
+    std::string_view rest = contents->originalBlock;
+    while(hasIds && !rest.empty()) {
+        size_t newline = rest.find('\n');
+        std::string_view line = rest.substr(0, newline);
+        uint64_t id;
+        hasIds = splitItemId(line, id).size() != line.size();
+        rest = newline == std::string_view::npos ? std::string_view() : rest.substr(newline + 1);
+    }
+
+    contents->blockIdsChecked = true;
+    contents->blockHasIds = hasIds;
+    return hasIds;
+}
+
+uint64_t Section::getFingerprint() {
+    if(contents->fingerprintValid) {
+        return contents->fingerprint;
+    }
+
+    // A clean section is identified by where its block lives, which is free,
+    // a changed one by hashing its items
+    const uint64_t prime = 1099511628211ULL;
+    if(!contents->dirty && contents->origin != nullptr) {
+        std::string_view block = contents->originalBlock;
+        uint64_t where[2] = {(uint64_t)(uintptr_t)block.data(), (uint64_t)block.size()};
+        contents->fingerprint = hashBytes(std::string_view((const char *)where, sizeof(where)));
+    } else {
+        uint64_t fingerprint = 14695981039346656037ULL;
+        indexAll();
+        contents->items.visitFrom(0, [&](const Entry & entry) {
+            fingerprint = (fingerprint ^ hashBytes(entry.text.view())) * prime;
+            return true;
+        });
+        contents->fingerprint = (fingerprint ^ (uint64_t)contents->items.size()) * prime;
+    }
+
+    contents->fingerprintValid = true;
+    return contents->fingerprint;
+}
+
+void Section::detach() {
+    // Chunks of handles are shared until they are changed, and so is the
+    // arena, so this copies no items and no text
+    if(contents.use_count() > 1) {
+        contents = std::make_shared<Contents>(*contents);
+    }
+}
+
+void Section::beginChange() {
+    // A changed section outlives the file it was loaded from, which may be
+    // rewritten in place, so the first change copies its items out of the
+    // mapping. Copies taken before (undo snapshots) still share the file.
+    detach();
+    indexAll();
+    markDirty();
+    if(contents->source == nullptr) { return; }
+
+    ItemArena & arena = itemArena();
+    ChunkedSequence<Entry> copied;
+    contents->items.visitFrom(0, [&](const Entry & entry) {
+        copied.push_back(Entry{arena.store(entry.text.view()), entry.id});
+        return true;
+    });
+    contents->items = std::move(copied);
+    contents->source.reset();
+}
+
+void Section::markDirty() {
+    contents->dirty = true;
+    contents->fingerprintValid = false;
+}
+
+void Section::dropChangedOrigin() {
+    // A file rewritten in place shows its new bytes through the old mapping,
+    // and faults past its new end, so the block can't be read any more. The
+    // section has to be compared by its items from then on. Copies share
+    // the origin, so they all lose it together.
+    if(contents->origin == nullptr || contents->origin->isUnchangedOnDisk()) {
+        return;
+    }
+
+    contents->origin.reset();
+    contents->originalBlock = std::string_view();
+    contents->dirty = true;
+    contents->fingerprintValid = false;
+    contents->blockIdsChecked = false;
+}
+
+bool Section::itemsMatchOriginal() {
+    // The block is the items joined by newlines, so walk both together. IDs
+    // in the block have to match, and be there at all when saves write them.
+    std::string_view rest = contents->originalBlock;
+    int numItems = getNumItems();
+    if(numItems == 0) {
+        return rest.empty();
+    }
+
+    bool withIds = itemIdsPersisted();
+    int seen = 0;
+    bool matches = true;
+    contents->items.visitFrom(0, [&](const Entry & entry) {
+        std::string_view item = entry.text.view();
+        if(rest.substr(0, item.size()) != item) {
+            matches = false;
+            return false;
+        }
+        rest.remove_prefix(item.size());
+
+        if(withIds || rest.substr(0, ITEM_ID_MARKER_LENGTH) == ITEM_ID_MARKER) {
+            std::string id = formatItemId(entry.id);
+            if(rest.substr(0, id.size()) != id) {
+                matches = false;
+                return false;
+            }
+            rest.remove_prefix(id.size());
+        }
+
+        seen++;
+        if(seen == numItems) {
+            matches = rest.empty();
+            return false;
+        }
+        if(rest.empty() || rest[0] != '\n') {
+            matches = false;
+            return false;
+        }
+        rest.remove_prefix(1);
+        return true;
+    });
+
+    return matches;
+}
+
+ItemArena & Section::itemArena() {
+    // Copies share the arena, since the text in it is never changed or freed
+    if(contents->arena == nullptr) {
+        contents->arena = std::make_shared<ItemArena>();
+    }
+
+    return *contents->arena;
+}
+
+void Section::indexThrough(int index) {
+    // Split off one line at a time until the requested line has been seen.
+    // The handles point into the mapping, which source keeps alive.
+    while((int)contents->items.size() <= index && !contents->pending.empty()) {
+        size_t newline = contents->pending.find('\n');
+        std::string_view line = contents->pending.substr(0, newline);
+        if(newline == std::string_view::npos) {
+            contents->pending = std::string_view();
+        } else {
+            contents->pending.remove_prefix(newline + 1);
+        }
+
+        uint64_t id;
+        std::string_view text = splitItemId(line, id);
+        pushItem(ItemRef::referTo(text), id);
+    }
+}
+
+void Section::indexAll() {
+    indexThrough(INT_MAX - 1);
+}
+
+void Section::describeThrough(int index) {
+    // Items are read for their metadata the first time it's asked for, so
+    // loading a list doesn't read every item twice
+    indexThrough(index);
+    ItemMetadata & metadata = contents->metadata;
+    if((int)metadata.size() > index) { return; }
+
+    contents->items.visitFrom(metadata.size(), [&](const Entry & entry) {
+        metadata.push_back(entry.text.view());
+        return (int)metadata.size() <= index;
+    });
+}
+
+void Section::unregisterItems() {
+    if(itemIndex == nullptr || !itemIndex->isActive() || contents == nullptr) { return; }
+
+    contents->items.visitFrom(0, [&](const Entry & entry) {
+        itemIndex->remove(entry.id);
+        return true;
+    });
+}
+
+void Section::pushItem(ItemRef text, uint64_t id) {
+    contents->items.push_back(Entry{text, id});
+    if(itemIndex != nullptr) {
+        itemIndex->add(id, this, (int)contents->items.size() - 1);
+    }
+}
@@ -1,10 +1,10 @@
 #include "SectionPanel.hpp"
 
-SectionPanel::SectionPanel(Box globalDimensionsIn, Section sectionIn) :
-    Panel(globalDimensionsIn, sectionIn.title), section(sectionIn), highlightIndex(0),
-    firstItemIndex(0) {
-    sectionColor = convertColorCodeToAttribute(section.colorCode);
-    lastItemIndex = std::min((int)section.items.size(), lines - 1);
+SectionPanel::SectionPanel(Box globalDimensionsIn, Section * sectionIn) :
+    Panel(globalDimensionsIn, sectionIn->title), section(sectionIn), highlightIndex(0),
+    firstItemIndex(0), searchMatches(nullptr), dirty(true) {
+    sectionColor = convertColorCodeToAttribute(section->colorCode);
+    lastItemIndex = section->countItemsUpTo(lines - 1);
 }
 
 int SectionPanel::convertColorCodeToAttribute(int code) {
@@ -18,6 +18,7 @@ void SectionPanel::drawPanel() {
     drawItems();
     drawIndicators();
     refreshWindow();
+    dirty = false;
 }
 
 void SectionPanel::drawTitleBar() {
@@ -50,29 +51,35 @@ void SectionPanel::drawTitle() {
 }
 
 std::string SectionPanel::widenTitle() {
-    std::string wideTitle = " " + truncateStringByLength(title, columns - 5) + " ";
+    std::string shownTitle = title;
+    if(filter != nullptr) {
+        shownTitle += " [" + filter->getSpec() + "]";
+    }
+    std::string wideTitle = " " + truncateStringByLength(shownTitle, columns - 5) + " ";
 
     return wideTitle;
 }
 
 void SectionPanel::drawItems() {
+    prefetchNeighbouringItems();
+
     int offset = 0;
-    int bound = std::min(lastItemIndex, getNumItems());
+    int bound = countShownItemsUpTo(lastItemIndex);
     for(int i = firstItemIndex; i < bound; i++) {
-        std::string item = section.items[i];
+        int itemIndex = toItemIndex(i);
+        std::string_view item = section->getItem(itemIndex);
         std::string truncItem = truncateStringByLength(item, columns - 2);
         offset++;
         drawItemWithOffset(truncItem, offset);
+        drawTokens(item, truncItem, itemIndex, offset);
+        drawSearchMatch(item, truncItem, itemIndex, offset);
     }
 }
 
 void SectionPanel::drawItemWithOffset(std::string item, int offset) {
-    // Draw item bar, then item name, so it spans the whole screen
-    Point a(2, offset); Point b(columns - 2, offset);
-    drawCustomHLineBetweenPoints(' ', a, b, win);
-
+    // Draw item name padded out to a bar, so it spans the whole screen
     Point itemPoint(2, offset);
-    drawStringAtPoint(item, itemPoint, win);
+    drawPaddedStringAtPoint(item, columns - 3, itemPoint, win);
 }
 
 void SectionPanel::drawIndicators() {
@@ -81,7 +88,7 @@ void SectionPanel::drawIndicators() {
     if(firstItemIndex > 0) {
         drawUpperIndicators();
     }
-    if(lastItemIndex < getNumItems()) {
+    if(hasShownItemAt(lastItemIndex)) {
         drawLowerIndicators();
     }
 }
@@ -116,14 +123,26 @@ void SectionPanel::drawPanelFocused() {
     drawItemsWithHighlight();
     drawIndicators();
     refreshWindow();
+    dirty = false;
+}
+
+bool SectionPanel::isDirty() {
+    return dirty;
+}
+
+void SectionPanel::markDirty() {
+    dirty = true;
 }
 
 void SectionPanel::drawItemsWithHighlight() {
+    prefetchNeighbouringItems();
+
     int offset = 0;
-    int bound = std::min(lastItemIndex, getNumItems());
+    int bound = countShownItemsUpTo(lastItemIndex);
     bool highlighted;
     for(int i = firstItemIndex; i < bound; i++) {
-        std::string item = section.items[i];
+        int itemIndex = toItemIndex(i);
+        std::string_view item = section->getItem(itemIndex);
         std::string truncItem = truncateStringByLength(item, columns - 2);
         highlighted = false;
         if(i == highlightIndex) {
@@ -132,20 +151,76 @@ void SectionPanel::drawItemsWithHighlight() {
         }
         offset++;
         drawItemWithOffset(truncItem, offset);
+        drawTokens(item, truncItem, itemIndex, offset);
+        drawSearchMatch(item, truncItem, itemIndex, offset);
         if(highlighted) {
             unsetAttributes(getAttribute("reverse"), win);
         }
     }
 }
 
-std::string SectionPanel::truncateStringByLength(std::string str, int length) {
+void SectionPanel::drawTokens(std::string_view item, std::string truncItem, int index, int offset) {
+    int numTokens;
+    const ItemToken * tokens = section->getItemTokens(index, numTokens);
+    if(numTokens == 0) { return; }
+
+    // Colour due dates, tags and priorities, as much of them as isn't cut off
+    size_t visible = truncItem.size() < item.size() ? truncItem.size() - 3 : truncItem.size();
+    for(int i = 0; i < numTokens; i++) {
+        size_t start = tokens[i].start;
+        if(start >= visible) { break; }
+
+        int tokenAttr;
+        if(tokens[i].kind == DUE_TOKEN) {
+            tokenAttr = convertColorCodeToAttribute(6);
+        } else if(tokens[i].kind == TAG_TOKEN) {
+            tokenAttr = convertColorCodeToAttribute(5);
+        } else {
+            tokenAttr = combineAttributes(2, convertColorCodeToAttribute(1), getAttribute("bold"));
+        }
+
+        size_t length = std::min((size_t)tokens[i].length, visible - start);
+        setAttributes(tokenAttr, win);
+        Point tokenPoint(2 + (int)start, offset);
+        drawStringAtPoint(item.substr(start, length), tokenPoint, win);
+        unsetAttributes(tokenAttr, win);
+    }
+}
+
+void SectionPanel::drawSearchMatch(std::string_view item, std::string truncItem, int index, int offset) {
+    if(searchMatches == nullptr || searchMatches->ids.empty()) { return; }
+    if(searchMatches->ids.count(section->getItemId(index)) == 0) { return; }
+
+    // Underline the first match, as much of it as isn't cut off
+    size_t start = SearchIndex::findIgnoringCase(item, searchMatches->query);
+    size_t visible = truncItem.size() < item.size() ? truncItem.size() - 3 : truncItem.size();
+    if(start == std::string_view::npos || start >= visible) { return; }
+
+    size_t length = std::min(searchMatches->query.size(), visible - start);
+    int matchAttr = combineAttributes(2, getAttribute("underline"), getAttribute("bold"));
+    setAttributes(matchAttr, win);
+    Point matchPoint(2 + (int)start, offset);
+    drawStringAtPoint(item.substr(start, length), matchPoint, win);
+    unsetAttributes(matchAttr, win);
+}
+
+void SectionPanel::prefetchNeighbouringItems() {
+    // Setting a filter already indexed every item
+    if(filter != nullptr) { return; }
+
+    // Keep a page of items on either side of the view ready for scrolling
+    int page = lines - 1;
+    section->prefetchItems(firstItemIndex - page, lastItemIndex + page);
+}
+
+std::string SectionPanel::truncateStringByLength(std::string_view str, int length) {
     int stringLength = str.size();
     if(stringLength >= length) {
-        std::string truncStr = str.substr(0, length - 4);
+        std::string truncStr(str.substr(0, std::max(length - 4, 0)));
         return truncStr + "...";
     }
 
-    return str;
+    return std::string(str);
 }
 
 void SectionPanel::scrollDown() {
@@ -157,12 +232,15 @@ void SectionPanel::scrollUp() {
 }
 
 void SectionPanel::incrementHighlightIndex() {
-    if(section.items.size() == 0) {
+    dirty = true;
+    if(!hasShownItemAt(0)) {
         highlightIndex = -1;
         return;
     }
 
-    highlightIndex = std::min(highlightIndex + 1, getNumItems() - 1);
+    if(hasShownItemAt(highlightIndex + 1)) {
+        highlightIndex++;
+    }
     if(highlightIndex >= lastItemIndex) {
         firstItemIndex++;
         lastItemIndex++;
@@ -170,7 +248,8 @@ void SectionPanel::incrementHighlightIndex() {
 }
 
 void SectionPanel::decrementHighlightIndex() {
-    if(section.items.size() == 0) {
+    dirty = true;
+    if(!hasShownItemAt(0)) {
         highlightIndex = -1;
         return;
     }
@@ -183,93 +262,381 @@ void SectionPanel::decrementHighlightIndex() {
 }
 
 Section SectionPanel::getSection() {
+    return *section;
+}
+
+Section & SectionPanel::getSectionRef() {
+    return *section;
+}
+
+Section * SectionPanel::getSectionHandle() {
     return section;
 }
 
 std::string SectionPanel::getSectionTitle() {
-    return section.title;
+    return section->title;
 }
 
 void SectionPanel::setSectionTitle(std::string newTitle) {
-    // section.title is for file serialization, setTitle() is for Panel title
-    section.title = newTitle;
+    // section->title is for file serialization, setTitle() is for Panel title
+    dirty = true;
+    section->title = newTitle;
     setTitle(newTitle);
 }
 
 std::string SectionPanel::getCurrentItem() {
-    return section.items[highlightIndex];
+    return std::string(section->getItem(toItemIndex(highlightIndex)));
+}
+
+int SectionPanel::getCurrentItemIndex() {
+    return toItemIndex(highlightIndex);
+}
+
+uint64_t SectionPanel::getCurrentItemId() {
+    return section->getItemId(toItemIndex(highlightIndex));
 }
 
 void SectionPanel::setCurrentItem(std::string item) {
-    int numItems = getNumItems();
-    if(numItems <= 0) { return; }
+    dirty = true;
+    if(!hasShownItemAt(0)) { return; }
 
     if(item == "") {
         deleteCurrentItem();
-    } else {
-        section.items[highlightIndex] = item;
+        return;
+    }
+
+    int itemIndex = toItemIndex(highlightIndex);
+    section->setItem(itemIndex, item);
+    int newIndex = section->keepItemInOrder(itemIndex);
+    if(newIndex != itemIndex) {
+        if(filter != nullptr) {
+            filter->itemErased(itemIndex);
+            filter->itemInserted(*section, newIndex);
+        }
+        followItem(newIndex);
+    } else if(filter != nullptr) {
+        filter->itemChanged(*section, itemIndex);
+        keepHighlightOnItem();
     }
 }
 
 void SectionPanel::deleteCurrentItem() {
-    section.items.erase(section.items.begin() + highlightIndex);
-    resetIndices();
+    dirty = true;
+    int itemIndex = toItemIndex(highlightIndex);
+    section->eraseItem(itemIndex);
+    if(filter != nullptr) {
+        filter->itemErased(itemIndex);
+    }
+
+    keepHighlightOnItem();
 }
 
-void SectionPanel::resetIndices() {
-    if(getNumItems() <= 0) {
+void SectionPanel::keepHighlightOnItem() {
+    // Stay where we were, on the item that moved up into the gap
+    if(!hasShownItemAt(0)) {
         highlightIndex = -1;
-    } else {
-        highlightIndex = 0;
+    } else if(!hasShownItemAt(highlightIndex)) {
+        highlightIndex--;
     }
-
-    firstItemIndex = 0;
-    lastItemIndex = std::min(getNumItems(), lines - 1);
+    keepHighlightInView();
 }
 
 int SectionPanel::getNumItems() {
-    return (int)section.items.size();
+    return countShownItems();
+}
+
+uint64_t SectionPanel::addItem(std::string newItem) {
+    if(newItem == "") { return 0; }
+
+    section->addItem(newItem);
+    uint64_t id = section->getItemId(section->getNumItems() - 1);
+    placeAddedItem();
+
+    return id;
 }
 
-void SectionPanel::addItem(std::string newItem) {
+void SectionPanel::addItem(std::string newItem, uint64_t id) {
     if(newItem == "") { return; }
 
-    section.items.push_back(newItem);
-    moveToEndOfItems();
+    section->addItem(newItem, id);
+    placeAddedItem();
+}
+
+void SectionPanel::placeAddedItem() {
+    // A section kept sorted takes the item to where it belongs
+    dirty = true;
+    int lastIndex = section->getNumItems() - 1;
+    int itemIndex = section->keepItemInOrder(lastIndex);
+    if(filter != nullptr) {
+        filter->itemInserted(*section, itemIndex);
+    }
+
+    if(itemIndex == lastIndex) {
+        moveToEndOfItems();
+    } else {
+        followItem(itemIndex);
+    }
+}
+
+void SectionPanel::followItem(int itemIndex) {
+    // A filter may hide the item, then the highlight stays where it was
+    if(filter != nullptr && !filter->isVisible(itemIndex)) {
+        keepHighlightOnItem();
+        return;
+    }
+
+    highlightIndex = toShownIndex(itemIndex);
+    keepHighlightInView();
 }
 
 void SectionPanel::moveToBeginningOfItems() {
+    dirty = true;
     highlightIndex = 0;
     firstItemIndex = 0;
-    lastItemIndex = std::min(getNumItems(), lines);
+    lastItemIndex = countShownItemsUpTo(lines);
 }
 
 void SectionPanel::moveToEndOfItems() {
-    highlightIndex = (int)section.items.size() - 1;
+    dirty = true;
+    highlightIndex = getNumItems() - 1;
     lastItemIndex = highlightIndex + 1;
     firstItemIndex = std::max(lastItemIndex - lines, 0);
 }
 
 void SectionPanel::incrementColorCode() {
-    int code = (section.colorCode % 7) + 1;
-    section.colorCode = code;
+    dirty = true;
+    int code = (section->colorCode % 7) + 1;
+    section->colorCode = code;
     sectionColor = convertColorCodeToAttribute(code);
 }
 
 void SectionPanel::swapItemDown() {
-    if(highlightIndex == (getNumItems() - 1)) {
+    // Items move past hidden neighbours too, one place at a time
+    dirty = true;
+    int itemIndex = toItemIndex(highlightIndex);
+    if(itemIndex == (section->getNumItems() - 1)) {
         return;
     }
 
-    std::swap(section.items[highlightIndex], section.items[highlightIndex + 1]);
-    incrementHighlightIndex();
+    section->swapItems(itemIndex, itemIndex + 1);
+    if(filter == nullptr) {
+        incrementHighlightIndex();
+        return;
+    }
+
+    filter->itemsSwapped(itemIndex, itemIndex + 1);
+    highlightIndex = filter->toVisibleIndex(itemIndex + 1);
+    keepHighlightInView();
 }
 
 void SectionPanel::swapItemUp() {
-    if(highlightIndex == 0) {
+    dirty = true;
+    int itemIndex = toItemIndex(highlightIndex);
+    if(itemIndex == 0) {
         return;
     }
 
-    std::swap(section.items[highlightIndex - 1], section.items[highlightIndex]);
-    decrementHighlightIndex();
+    section->swapItems(itemIndex - 1, itemIndex);
+    if(filter == nullptr) {
+        decrementHighlightIndex();
+        return;
+    }
+
+    filter->itemsSwapped(itemIndex - 1, itemIndex);
+    highlightIndex = filter->toVisibleIndex(itemIndex - 1);
+    keepHighlightInView();
+}
+
+void SectionPanel::sortItems(SortOrder order, bool keep) {
+    dirty = true;
+    int itemIndex = hasShownItemAt(highlightIndex) ? toItemIndex(highlightIndex) : -1;
+    std::vector<int> positions;
+    if(order != UNSORTED) {
+        positions = section->sortItems(order);
+    }
+    section->sortOrder = keep ? order : UNSORTED;
+    if(positions.empty()) { return; }
+
+    if(filter != nullptr) {
+        filter->rebuild(*section);
+    }
+    if(itemIndex < 0) {
+        keepHighlightOnItem();
+        return;
+    }
+
+    int numItems = (int)positions.size();
+    for(int i = 0; i < numItems; i++) {
+        if(positions[i] == itemIndex) {
+            followItem(i);
+            return;
+        }
+    }
+}
+
+bool SectionPanel::showsSection(Section & other) {
+    return section->hasSameContentsAs(other);
+}
+
+void SectionPanel::updateSection(Section newSection) {
+    dirty = true;
+    std::string highlightedItem = "";
+    uint64_t highlightedId = 0;
+    int itemIndex = -1;
+    // A section read from a file rewritten in place can't tell us which
+    // item was highlighted, so the highlight just stays put
+    if(!section->sourceChangedOnDisk() && hasShownItemAt(highlightIndex)) {
+        itemIndex = toItemIndex(highlightIndex);
+        highlightedItem = std::string(section->getItem(itemIndex));
+        highlightedId = section->getItemId(itemIndex);
+    }
+
+    *section = newSection;
+    setTitle(section->title);
+    sectionColor = convertColorCodeToAttribute(section->colorCode);
+    if(filter != nullptr) {
+        filter->rebuild(*section);
+    }
+
+    // Follow the highlighted item if it only moved, otherwise stay put. Its
+    // ID finds it after an undo, its text after a reload.
+    if(!hasShownItemAt(0)) {
+        highlightIndex = -1;
+    } else {
+        int found = -1;
+        if(highlightedId != 0) {
+            found = section->findItemById(highlightedId, itemIndex, RELOAD_SEARCH_RADIUS);
+        }
+        if(found < 0) {
+            found = findItemNear(highlightedItem, itemIndex);
+        }
+        if(found >= 0) {
+            highlightIndex = toShownIndex(found);
+        }
+        if(!hasShownItemAt(highlightIndex)) {
+            highlightIndex = std::max(countShownItems() - 1, 0);
+        }
+    }
+
+    keepHighlightInView();
+}
+
+int SectionPanel::findItemNear(std::string item, int index) {
+    if(item == "") { return -1; }
+
+    index = std::max(index, 0);
+    for(int distance = 0; distance <= RELOAD_SEARCH_RADIUS; distance++) {
+        int below = index + distance;
+        int above = index - distance;
+        bool belowExists = section->hasItemAt(below);
+        if(belowExists && section->getItem(below) == item) {
+            return below;
+        }
+        if(section->hasItemAt(above) && section->getItem(above) == item) {
+            return above;
+        }
+        if(!belowExists && above <= 0) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+void SectionPanel::relocate(Box newGlobalDimensions) {
+    if(newGlobalDimensions.ul.x == globalDimensions.ul.x &&
+       newGlobalDimensions.ul.y == globalDimensions.ul.y &&
+       newGlobalDimensions.lr.x == globalDimensions.lr.x &&
+       newGlobalDimensions.lr.y == globalDimensions.lr.y) {
+        return;
+    }
+
+    resizePanel(newGlobalDimensions);
+    keepHighlightInView();
+    dirty = true;
+}
+
+void SectionPanel::showSearchMatches(SearchMatches * matches) {
+    if(matches != searchMatches) {
+        dirty = true;
+    }
+    searchMatches = matches;
+}
+
+void SectionPanel::highlightItemAt(int index) {
+    dirty = true;
+    if(!section->hasItemAt(index)) { return; }
+
+    if(filter != nullptr && !filter->isVisible(index)) {
+        filter.reset();
+    }
+    highlightIndex = toShownIndex(index);
+    keepHighlightInView();
+}
+
+void SectionPanel::setFilter(std::string spec) {
+    dirty = true;
+    int itemIndex = hasShownItemAt(highlightIndex) ? toItemIndex(highlightIndex) : 0;
+    if(spec == "") {
+        filter.reset();
+    } else {
+        filter = std::make_unique<ItemFilter>(spec);
+        filter->rebuild(*section);
+    }
+
+    // Keep the highlight on the same item, or the next one still shown
+    highlightIndex = toShownIndex(itemIndex);
+    if(!hasShownItemAt(highlightIndex)) {
+        highlightIndex = countShownItems() - 1;
+    }
+    keepHighlightInView();
+}
+
+std::string SectionPanel::getFilter() {
+    return filter == nullptr ? "" : filter->getSpec();
+}
+
+void SectionPanel::keepHighlightInView() {
+    int visible = std::max(lines - 1, 1);
+    if(highlightIndex < 0) {
+        firstItemIndex = 0;
+    } else if(highlightIndex < firstItemIndex) {
+        firstItemIndex = highlightIndex;
+    } else if(highlightIndex >= firstItemIndex + visible) {
+        firstItemIndex = highlightIndex - visible + 1;
+    }
+
+    lastItemIndex = firstItemIndex + visible;
+}
+
+int SectionPanel::countShownItems() {
+    return filter == nullptr ? section->getNumItems() : filter->getNumVisible();
+}
+
+int SectionPanel::countShownItemsUpTo(int bound) {
+    if(filter == nullptr) {
+        return section->countItemsUpTo(bound);
+    }
+
+    return std::min(bound, filter->getNumVisible());
+}
+
+bool SectionPanel::hasShownItemAt(int index) {
+    if(filter == nullptr) {
+        return section->hasItemAt(index);
+    }
+
+    return index >= 0 && index < filter->getNumVisible();
+}
+
+int SectionPanel::toItemIndex(int shownIndex) {
+    if(filter == nullptr || shownIndex < 0) {
+        return shownIndex;
+    }
+
+    return filter->toItemIndex(shownIndex);
+}
+
+int SectionPanel::toShownIndex(int itemIndex) {
+    return filter == nullptr ? itemIndex : filter->toVisibleIndex(itemIndex);
 }
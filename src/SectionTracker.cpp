@@ -0,0 +1,61 @@
+#include "SectionTracker.hpp"
+
+#include <unordered_set>
+
+SectionTracker::SectionTracker() : buildDone(false), cancelled(false) {}
+
+SectionTracker::~SectionTracker() {
+    stopBuild();
+}
+
+size_t SectionTracker::prepareBuild(Document * document) {
+    // The builder only reads its copies. Lazy sections are indexed here
+    // first, since indexing a copy would write to what it shares.
+    building.clear();
+    size_t numItems = 0;
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        Section * section = document->getSection(i);
+        numItems += section->getNumItems();
+        building.push_back(Tracked{section, *section, ItemMetadata()});
+    }
+
+    return numItems;
+}
+
+bool SectionTracker::isBuilding() {
+    return builder.joinable();
+}
+
+bool SectionTracker::hasFinishedBuild() {
+    return isBuilding() && buildDone;
+}
+
+void SectionTracker::finishBuild(Document * document) {
+    builder.join();
+
+    // Sections removed meanwhile are left alone, the rest only take what
+    // the build read if they haven't changed since
+    std::unordered_set<Section *> live;
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        live.insert(document->getSection(i));
+    }
+    for(Tracked & entry : building) {
+        if(entry.described.size() > 0 && live.count(entry.handle) > 0) {
+            entry.handle->adoptMetadata(entry.snapshot, entry.described);
+        }
+        entry.described = ItemMetadata();
+    }
+
+    tracked = std::move(building);
+    building.clear();
+}
+
+void SectionTracker::stopBuild() {
+    if(!builder.joinable()) { return; }
+
+    cancelled = true;
+    builder.join();
+    building.clear();
+}
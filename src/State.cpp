@@ -1,15 +1,45 @@
 #include "State.hpp"
 
+#include <algorithm>
+
+#include "ItemTokens.hpp"
+#include "PanelConstructor.hpp"
+
 State::State(std::string listPathIn) :
-    listPath(listPathIn), exitFlag(false), mode(Mode::NORMAL), unsavedChanges(false) {}
+    currentPanel(0), listPath(listPathIn), exitFlag(false), mode(Mode::NORMAL), unsavedChanges(false),
+    changeGeneration(0), submittedGeneration(0), savedFingerprint(0),
+    events(nullptr), watcher(nullptr), upcoming("Upcoming", 1), upcomingPanel(nullptr), upcomingDay(0),
+    modeIndicatorDirty(true) {
+    // Before the writer starts its thread, which has to inherit the blocked
+    // SIGWINCH
+    events = new EventLoop();
+    document = new Document();
+    writer = new ListWriter();
+    journal = new ListJournal();
+    history = new EditHistory();
+    search = new SearchIndex();
+    due = new DueIndex();
+}
 
 State::~State() {
+    delete search;
+    delete upcomingPanel;
+    delete due;
 	for(SectionPanel * panel : panels) {
 		delete panel;
 	}
+    delete document;
+
+    // The writer finishes any save still in flight before it goes
+    delete writer;
+    delete watcher;
+    delete journal;
+    delete history;
+    delete events;
 }
 
 void State::addPanel(SectionPanel * panel) {
+    panel->showSearchMatches(&searchMatches);
 	panels.push_back(panel);
 }
 
@@ -17,20 +47,48 @@ std::vector<SectionPanel *> State::getPanels() {
 	return panels;
 }
 
+Document * State::getDocument() {
+    return document;
+}
+
 int State::getNumPanels() {
     return (int)panels.size();
 }
 
 void State::replacePanels(std::vector<SectionPanel *> newPanels) {
+    // Panels carried over into the new set (e.g. by a reload) are kept alive
     for(SectionPanel * panel : panels) {
-        delete panel;
+        if(std::find(newPanels.begin(), newPanels.end(), panel) == newPanels.end()) {
+            delete panel;
+        }
     }
 
     panels = newPanels;
+    for(SectionPanel * panel : panels) {
+        panel->showSearchMatches(&searchMatches);
+    }
+    arrangeDocument();
+}
+
+void State::arrangeDocument() {
+    // The document follows the panels, and sections without one are gone
+    std::vector<Section *> order;
+    for(SectionPanel * panel : panels) {
+        order.push_back(panel->getSectionHandle());
+    }
+
+    document->arrange(order);
 }
 
 void State::setCurrentPanel(int panelIndex) {
 	panelIndex = wrapIndex(panelIndex);
+
+    // Only the panels losing and gaining the highlight look any different
+    for(int index : {currentPanel, panelIndex}) {
+        if(index >= 0 && index < (int)panels.size()) {
+            panels[index]->markDirty();
+        }
+    }
 	currentPanel = panelIndex;
 }
 
@@ -51,8 +109,10 @@ SectionPanel * State::getCurrentPanel() {
 }
 
 void State::removeCurrentPanel() {
+    Section * section = panels[currentPanel]->getSectionHandle();
     delete panels[currentPanel];
     panels.erase(panels.begin() + currentPanel);
+    document->removeSection(section);
     resetIndices();
 }
 
@@ -69,12 +129,7 @@ bool State::panelIsFocused(SectionPanel * panel) {
 }
 
 std::vector<Section> State::getSections() {
-    std::vector<Section> sections;
-    for(SectionPanel * panel : panels) {
-        sections.push_back(panel->getSection());
-    }
-
-    return sections;
+    return document->copySections();
 }
 
 void State::setExitFlag(bool flag) {
@@ -95,6 +150,24 @@ Mode State::getMode() {
 
 void State::setMode(Mode newMode) {
     mode = newMode;
+    modeIndicatorDirty = true;
+}
+
+void State::markScreenDirty() {
+    markPanelsDirty();
+    modeIndicatorDirty = true;
+}
+
+void State::markModeIndicatorDirty() {
+    modeIndicatorDirty = true;
+}
+
+bool State::modeIndicatorIsDirty() {
+    return modeIndicatorDirty;
+}
+
+void State::modeIndicatorDrawn() {
+    modeIndicatorDirty = false;
 }
 
 void State::swapPanelDown() {
@@ -103,6 +176,7 @@ void State::swapPanelDown() {
     }
 
     std::swap(panels[currentPanel], panels[currentPanel + 1]);
+    document->swapSections(currentPanel, currentPanel + 1);
     currentPanel++;
 }
 
@@ -112,6 +186,7 @@ void State::swapPanelUp() {
     }
 
     std::swap(panels[currentPanel - 1], panels[currentPanel]);
+    document->swapSections(currentPanel - 1, currentPanel);
     currentPanel--;
 }
 
@@ -120,13 +195,258 @@ bool State::userHasUnsavedChanges() {
 }
 
 void State::changesMade() {
+    markChanged();
+    if(history->isEnabled()) {
+        history->record(takeSnapshot());
+    }
+    refreshSearch();
+    refreshUpcoming();
+}
+
+void State::changesRestored() {
+    // Undo and redo aren't journaled, so the next save writes the whole list
+    markChanged();
+    journal->requireCompaction();
+    refreshSearch();
+    refreshUpcoming();
+}
+
+void State::markChanged() {
     unsavedChanges = true;
+    changeGeneration++;
+    lastChangeTime = std::chrono::steady_clock::now();
+}
+
+void State::resetHistory() {
+    if(history->isEnabled()) {
+        history->reset(takeSnapshot());
+    }
+}
+
+EditHistory * State::getHistory() {
+    return history;
+}
+
+SearchIndex * State::getSearchIndex() {
+    return search;
+}
+
+SearchMatches * State::getSearchMatches() {
+    return &searchMatches;
+}
+
+void State::showSearchResults(std::string query, std::vector<uint64_t> & ids) {
+    std::string lowered = SearchIndex::lowercase(query);
+    std::unordered_set<uint64_t> found(ids.begin(), ids.end());
+
+    // Searching again after every edit mostly finds what is already shown
+    if(lowered == searchMatches.query && found == searchMatches.ids) { return; }
+
+    searchMatches.query = lowered;
+    searchMatches.ids = std::move(found);
+    // Matches are underlined wherever they are
+    markPanelsDirty();
+}
+
+void State::runSearch(std::string query) {
+    std::vector<uint64_t> ids = search->find(document, query);
+    showSearchResults(query, ids);
+}
+
+void State::clearSearch() {
+    if(searchMatches.query.empty() && searchMatches.ids.empty()) { return; }
+
+    searchMatches.query.clear();
+    searchMatches.ids.clear();
+    markPanelsDirty();
+}
+
+void State::markPanelsDirty() {
+    if(upcomingPanel != nullptr) {
+        upcomingPanel->markDirty();
+    }
+    for(SectionPanel * panel : panels) {
+        panel->markDirty();
+    }
+}
+
+void State::refreshSearch() {
+    if(searchMatches.query.empty()) {
+        search->sync(document);
+    } else {
+        runSearch(searchMatches.query);
+    }
+}
+
+void State::showUpcoming(Box bounds) {
+    upcomingPanel = new SectionPanel(bounds, &upcoming);
+    upcomingPanel->showSearchMatches(&searchMatches);
+    due->build(document, ItemTokens::today());
+}
+
+SectionPanel * State::getUpcomingPanel() {
+    return upcomingPanel;
+}
+
+void State::refreshUpcoming() {
+    if(upcomingPanel == nullptr) { return; }
+
+    upcomingDay = ItemTokens::today();
+    due->sync(document, upcomingDay);
+
+    // Only what fits is read out of the index
+    int lastDate = ItemTokens::addDays(upcomingDay, DueIndex::upcomingDays());
+    Section shown(upcoming.title, upcoming.colorCode);
+    for(DueIndex::DueItem & item : due->findDueBy(lastDate, UPCOMING_PANEL_LINES - 1)) {
+        shown.addItem(item.section->title + ": " + std::string(item.text), item.id);
+    }
+
+    // Most edits don't touch what is due soonest, and then the panel is left
+    // alone rather than drawn again
+    if(upcomingShows(shown)) { return; }
+
+    upcomingPanel->updateSection(shown);
+    upcomingPanel->moveToBeginningOfItems();
+}
+
+bool State::upcomingShows(Section & shown) {
+    if(!upcoming.hasSameContentsAs(shown)) {
+        return false;
+    }
+
+    // The IDs matter too, search matches are found by them
+    int numItems = shown.getNumItems();
+    for(int i = 0; i < numItems; i++) {
+        if(upcoming.getItemId(i) != shown.getItemId(i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void State::refreshUpcomingIfStale() {
+    if(upcomingPanel == nullptr) { return; }
+
+    if(due->hasFinishedBuild() || ItemTokens::today() != upcomingDay) {
+        refreshUpcoming();
+    }
+}
+
+void State::relayoutPanels() {
+    PanelConstructor::relayoutPanels(panels);
+    if(upcomingPanel != nullptr) {
+        upcomingPanel->relocate(PanelConstructor::generateUpcomingBounds());
+    }
+}
+
+EditHistory::Snapshot State::takeSnapshot() {
+    return EditHistory::Snapshot{getSections(), currentPanel};
 }
 
 void State::changesSaved() {
     unsavedChanges = false;
+
+    // What is on disk now is our own doing, not something to reload
+    if(watcher != nullptr) {
+        watcher->acknowledgeChanges();
+    }
+}
+
+void State::changesSavedAt(uint64_t generation) {
+    // Edits made while the save was being written are still unsaved
+    if(generation == changeGeneration) {
+        changesSaved();
+    } else if(watcher != nullptr) {
+        watcher->acknowledgeChanges();
+    }
+}
+
+void State::changesSubmitted() {
+    submittedGeneration = changeGeneration;
+    rememberSavedSections();
+}
+
+void State::saveFailed() {
+    // Nothing written so far can be counted on, so save again
+    submittedGeneration = 0;
+    savedFingerprint = 0;
+}
+
+bool State::hasUnsubmittedChanges() {
+    return unsavedChanges && submittedGeneration != changeGeneration;
+}
+
+void State::setSavedFingerprint(uint64_t fingerprint) {
+    savedFingerprint = fingerprint;
+}
+
+uint64_t State::getSavedFingerprint() {
+    return savedFingerprint;
+}
+
+void State::rememberSavedSections() {
+    savedSections.clear();
+    int numSections = document->getNumSections();
+    for(int i = 0; i < numSections; i++) {
+        Section * section = document->getSection(i);
+        savedSections.push_back(SavedSection{section, *section});
+    }
+}
+
+void State::setSavedSections(std::vector<SavedSection> sections) {
+    savedSections = std::move(sections);
+}
+
+std::vector<SavedSection> & State::getSavedSections() {
+    return savedSections;
+}
+
+std::chrono::steady_clock::time_point State::getLastChangeTime() {
+    return lastChangeTime;
+}
+
+uint64_t State::getChangeGeneration() {
+    return changeGeneration;
+}
+
+ListWriter * State::getListWriter() {
+    return writer;
+}
+
+ListJournal * State::getJournal() {
+    return journal;
 }
 
 std::string State::getListPath() {
     return listPath;
 }
+
+void State::watchList(std::string absListPath) {
+    delete watcher;
+    watcher = new ListWatcher(absListPath);
+}
+
+bool State::listChangedOnDisk() {
+    if(watcher == nullptr) {
+        return false;
+    }
+
+    return watcher->listHasChanged();
+}
+
+int State::getListWatchFd() {
+    if(watcher == nullptr) {
+        return -1;
+    }
+
+    return watcher->getFd();
+}
+
+EventLoop * State::getEventLoop() {
+    return events;
+}
+
+bool State::hasBackgroundWork() {
+    return writer->isBusy() || (upcomingPanel != nullptr && due->isBuilding());
+}
@@ -17,6 +17,13 @@ void printKeybindingsHelp() {
     std::cout << "  d,D - delete focused item/section" << std::endl;
     std::cout << "  m   - enter move mode" << std::endl;
     std::cout << "  c   - cycle focused section color" << std::endl;
+    std::cout << "  /   - search all sections as you type" << std::endl;
+    std::cout << "  ;,, - jump to next/previous search match" << std::endl;
+    std::cout << "  f   - fuzzy find any item and jump to it" << std::endl;
+    std::cout << "  F   - filter focused section (text, /regex/, #tag, !N, @week, ...)" << std::endl;
+    std::cout << "  o,O - sort focused section/all sections" << std::endl;
+    std::cout << "  u   - undo the last change" << std::endl;
+    std::cout << "  ^R  - redo the last undone change" << std::endl;
     std::cout << "  s   - save any unsaved changes" << std::endl << std::endl;
 
     std::cout << "--=== MOVE MODE ===--" << std::endl << std::endl;
@@ -24,7 +31,10 @@ void printKeybindingsHelp() {
     std::cout << "  q   - quit cascade" << std::endl;
     std::cout << "  j,k - move focused item up and down" << std::endl;
     std::cout << "  J,K - move focused section up and down" << std::endl;
+    std::cout << "  o,O - sort focused section/all sections" << std::endl;
     std::cout << "  m   - exit move mode" << std::endl;
+    std::cout << "  u   - undo the last change" << std::endl;
+    std::cout << "  ^R  - redo the last undone change" << std::endl;
     std::cout << "  s   - save any unsaved changes" << std::endl;
 }
 
@@ -39,7 +49,31 @@ void printConfigHelp() {
     std::cout << "               This is set to ~/.cascade/master.todo by default." << std::endl << std::endl;
 
     std::cout << "  DefaultSectionColor - The default color of new sections when they are created." << std::endl;
-    std::cout << "                        This is set to white by default." << std::endl;
+    std::cout << "                        This is set to white by default." << std::endl << std::endl;
+
+    std::cout << "  LazyLoading - When true, items are only read from the list file once they are shown or edited." << std::endl;
+    std::cout << "                This makes opening very large lists much faster. This is set to false by default." << std::endl << std::endl;
+
+    std::cout << "  IndexCache - When true, cascade keeps a binary index next to the list (e.g. master.todo.idx)" << std::endl;
+    std::cout << "               so it can be opened without parsing it again. This is set to true by default." << std::endl << std::endl;
+
+    std::cout << "  Journal - When true, saving appends your edits to a journal next to the list (e.g. master.todo.journal)" << std::endl;
+    std::cout << "            instead of rewriting the whole list. The journal is folded back into the list once it grows" << std::endl;
+    std::cout << "            past 1 MiB or half the size of the list. This is set to false by default." << std::endl << std::endl;
+
+    std::cout << "  AutosaveDelayMs - When above 0, changes are saved automatically once no edit has been made for this" << std::endl;
+    std::cout << "                    many milliseconds, and at most once per that many milliseconds. This is set to 0" << std::endl;
+    std::cout << "                    (autosave off) by default." << std::endl << std::endl;
+
+    std::cout << "  UndoDepth - How many changes can be undone. Setting this to 0 turns undo off." << std::endl;
+    std::cout << "              This is set to 100 by default." << std::endl << std::endl;
+
+    std::cout << "  PersistItemIds - When true, each item is saved with its ID after a tab (e.g. Buy milk\\t@id=1f...)," << std::endl;
+    std::cout << "                   so it keeps the same ID the next time the list is opened. This is set to false by default." << std::endl << std::endl;
+
+    std::cout << "  UpcomingDays - How many days ahead the Upcoming panel at the top looks. It lists overdue items and those" << std::endl;
+    std::cout << "                 due within that many days, from every section. Setting this to 0 hides the panel." << std::endl;
+    std::cout << "                 This is set to 7 by default." << std::endl;
 }
 
 void printListHelp() {
@@ -53,6 +87,7 @@ void printListHelp() {
     std::cout << "  - Section lines must be of the format [Title] : ColorCode" << std::endl;
     std::cout << "  - There must be a blank line between sections." << std::endl;
     std::cout << "  - There cannot be a blank line between items of the same section." << std::endl;
+    std::cout << "  - An item may end in a tab followed by @id=<hex>, which is its ID rather than part of its text." << std::endl;
 }
 
 void printHelpInfo(int argc, char ** argv) {
@@ -1,5 +1,8 @@
 #include "vexes.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+
 //////////////////////////////// CONSTANTS ///////////////////////////////////
 
 // This map is used to make using attributes easier and more readable
@@ -26,6 +29,12 @@ static const std::map<std::string, int> attributes = {
 
 /////////////////////////////// DRAWING UTILS ////////////////////////////////
 
+// Unlike waddch(), whline() and wvline() don't pick up the attributes set on
+// the window, so spans carry them along themselves
+static chtype spanChar(char ch, WINDOW * win) {
+    return (chtype)(unsigned char)ch | getattrs(win);
+}
+
 int getAttribute(std::string name) {
     auto iter = attributes.find(name);
     // Check if name exists, otherwise return A_NORMAL
@@ -59,17 +68,13 @@ void drawCharAtPoint(char ch, Point p, WINDOW * win) {
     }
 }
 
-void drawStringAtPoint(std::string text, Point p, WINDOW * win) {
-    if(win != NULL) {
-        wmove(win, p.y, p.x);
-        waddstr(win, text.c_str());
-    } else {
-        move(p.y, p.x);
-        addstr(text.c_str());
-    }
+void drawStringAtPoint(std::string_view text, Point p, WINDOW * win) {
+    if(win == NULL) { win = stdscr; }
+
+    mvwaddnstr(win, p.y, p.x, text.data(), (int)text.size());
 }
 
-void drawCenteredStringAtPoint(std::string text, Point p, WINDOW * win) {
+void drawCenteredStringAtPoint(std::string_view text, Point p, WINDOW * win) {
     // Compute new point offset by half of string's length
     size_t offset = text.size() / 2;
     Point newPoint(p.x - offset, p.y);
@@ -78,6 +83,16 @@ void drawCenteredStringAtPoint(std::string text, Point p, WINDOW * win) {
     drawStringAtPoint(text, newPoint, win);
 }
 
+void drawPaddedStringAtPoint(std::string_view text, int width, Point p, WINDOW * win) {
+    if(win == NULL) { win = stdscr; }
+
+    int length = std::min((int)text.size(), std::max(width, 0));
+    drawStringAtPoint(text.substr(0, length), p, win);
+    if(length < width) {
+        mvwhline(win, p.y, p.x + length, spanChar(' ', win), width - length);
+    }
+}
+
 void setAttributes(int attr, WINDOW * win) {
     if(win != NULL) {
         wattron(win, attr);
@@ -97,39 +112,21 @@ void unsetAttributes(int attr, WINDOW * win) {
 void drawCustomHLineBetweenPoints(char ch, Point a, Point b, WINDOW * win) {
     // Only draw line if points are on the same Y level
     if(Point::pointsHaveUnequalY(a, b)) { return; }
+    if(win == NULL) { win = stdscr; }
 
-    // To avoid issues of order, we check which x is larger
-    if(a.x < b.x) {
-        for(int i = a.x; i < b.x + 1; i++) {
-            drawCharAtPoint(ch, Point(i, a.y), win);
-        }
-    } else if(a.x > b.x) {
-        for(int i = b.x; i < a.x + 1; i++) {
-            drawCharAtPoint(ch, Point(i, b.y), win);
-        }
-    } else {
-        // x is equal, so we only draw a single character
-        drawCharAtPoint(ch, a, win);
-    }
+    // To avoid issues of order, we start from whichever x is smaller
+    int left = std::min(a.x, b.x);
+    mvwhline(win, a.y, left, spanChar(ch, win), std::abs(a.x - b.x) + 1);
 }
 
 void drawCustomVLineBetweenPoints(char ch, Point a, Point b, WINDOW * win) {
     // Only draw line if points are on the same X level
     if(Point::pointsHaveUnequalX(a, b)) { return; }
+    if(win == NULL) { win = stdscr; }
 
-    // To avoid issues of order, we check which y is larger
-    if(a.y < b.y) {
-        for(int i = a.y; i < b.y + 1; i++) {
-            drawCharAtPoint(ch, Point(a.x, i), win);
-        }
-    } else if(a.y > b.y) {
-        for(int i = b.y; i < a.y + 1; i++) {
-            drawCharAtPoint(ch, Point(b.x, i), win);
-        }
-    } else {
-        // y is equal, so we only draw a single character
-        drawCharAtPoint(ch, a, win);
-    }
+    // To avoid issues of order, we start from whichever y is smaller
+    int top = std::min(a.y, b.y);
+    mvwvline(win, top, a.x, spanChar(ch, win), std::abs(a.y - b.y) + 1);
 }
 
 void drawHLineBetweenPoints(Point a, Point b, WINDOW * win) {
@@ -174,21 +171,13 @@ void drawBox(Box b, WINDOW * win) {
 }
 
 void fillBoxWithChar(Box b, char ch, WINDOW * win) {
-    for(int y = b.ul.y; y < b.lr.y + 1; y++) {
-        // Draw one line at a time to take advantage of addch()
-        if(win != NULL) {
-            wmove(win, y, b.ul.x);
-        } else {
-            move(y, b.ul.x);
-        }
+    if(win == NULL) { win = stdscr; }
 
-        for(int x = b.ul.x; x < b.lr.x + 1; x++) {
-            if(win != NULL) {
-                waddch(win, ch);
-            } else {
-                addch(ch);
-            }
-        }
+    // One span per line
+    chtype span = spanChar(ch, win);
+    int width = b.lr.x - b.ul.x + 1;
+    for(int y = b.ul.y; y < b.lr.y + 1; y++) {
+        mvwhline(win, y, b.ul.x, span, width);
     }
 }
 
@@ -196,6 +185,12 @@ void clearBox(Box b, WINDOW * win) {
     fillBoxWithChar(b, ' ', win);
 }
 
+void clearWindow(WINDOW * win) {
+    if(win == NULL) { win = stdscr; }
+
+    werase(win);
+}
+
 /////////////////////////////// BASE CLASSES /////////////////////////////////
 
 /* ENGINE */
@@ -220,7 +215,7 @@ void Engine::initializeScreenVariables() {
     noecho();		        // Disable echoing keys to console
     start_color();		    // Enable color mode
     curs_set(0);		    // Set cursor to be invisible
-    timeout(50);		    // Make getch a non-blocking call
+    nodelay(stdscr, TRUE);  // Make getch a non-blocking call, waiting is up to the engine
 }
 
 void Engine::initializeColorPairs() {
@@ -264,6 +259,10 @@ Panel::~Panel() {
 
 void Panel::setupWindow() {
     win = newwin(lines + 1, columns + 1, globalDimensions.ul.y, globalDimensions.ul.x);
+
+    // Panels never show the cursor, so curses needn't spend bytes on parking
+    // it after every update
+    leaveok(win, TRUE);
 }
 
 void Panel::teardownWindow() {
@@ -286,7 +285,8 @@ void Panel::drawTitle() {
 }
 
 void Panel::refreshWindow() {
-    wrefresh(win);
+    // Only queued, doupdate() sends every queued window out at once
+    wnoutrefresh(win);
 }
 
 void Panel::resizePanel(Box newGlobalDimensions) {
@@ -306,7 +306,8 @@ void Panel::replaceWindow() {
 }
 
 void Panel::clearScreen() {
-    clearBox(localDimensions, win);
+    // localDimensions covers the whole window
+    clearWindow(win);
 }
 
 WINDOW * Panel::getWin() {